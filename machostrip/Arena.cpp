@@ -0,0 +1,100 @@
+//
+//  Arena.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "Arena.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace machostrip {
+
+Arena::~Arena() { release(Head); }
+
+Arena::Arena(Arena &&Other) noexcept
+    : Head(std::exchange(Other.Head, nullptr)),
+      Cur(std::exchange(Other.Cur, nullptr)),
+      End(std::exchange(Other.End, nullptr)), BlockSize(Other.BlockSize) {}
+
+Arena &Arena::operator=(Arena &&Other) noexcept {
+  if (this != &Other) {
+    release(Head);
+    Head = std::exchange(Other.Head, nullptr);
+    Cur = std::exchange(Other.Cur, nullptr);
+    End = std::exchange(Other.End, nullptr);
+    BlockSize = Other.BlockSize;
+  }
+  return *this;
+}
+
+void Arena::release(Block *B) {
+  while (B) {
+    Block *Next = B->Next;
+    std::free(B);
+    B = Next;
+  }
+}
+
+void Arena::grow(size_t Size, size_t Align) {
+  // blocks double up to a few megabytes, an oversized request gets a block
+  // of its own
+  size_t size = std::max(BlockSize, Size + Align + sizeof(Block));
+  Block *B = static_cast<Block *>(std::malloc(size));
+  if (!B)
+    throw std::bad_alloc();
+  B->Next = Head;
+  B->Size = size;
+  Head = B;
+  Cur = reinterpret_cast<uint8_t *>(B + 1);
+  End = reinterpret_cast<uint8_t *>(B) + size;
+  BlockSize = std::min<size_t>(BlockSize * 2, 4 << 20);
+}
+
+void *Arena::allocate(size_t Size, size_t Align) {
+  uintptr_t p = ((uintptr_t)Cur + Align - 1) & ~(uintptr_t)(Align - 1);
+  if (!Cur || p + Size > (uintptr_t)End) {
+    grow(Size, Align);
+    p = ((uintptr_t)Cur + Align - 1) & ~(uintptr_t)(Align - 1);
+  }
+  Cur = reinterpret_cast<uint8_t *>(p + Size);
+  return reinterpret_cast<void *>(p);
+}
+
+std::string_view Arena::copy(std::string_view S) {
+  return concat(S, {});
+}
+
+std::string_view Arena::concat(std::string_view L, std::string_view R) {
+  if (L.empty() && R.empty())
+    return {};
+  char *P = static_cast<char *>(allocate(L.size() + R.size(), 1));
+  if (!L.empty())
+    std::memcpy(P, L.data(), L.size());
+  if (!R.empty())
+    std::memcpy(P + L.size(), R.data(), R.size());
+  return {P, L.size() + R.size()};
+}
+
+void Arena::reset() {
+  if (!Head)
+    return;
+  // the oldest block is the last one in the list
+  Block *First = Head, *Prev = nullptr;
+  while (First->Next) {
+    Prev = First;
+    First = First->Next;
+  }
+  if (Prev) {
+    Prev->Next = nullptr;
+    release(Head);
+  }
+  Head = First;
+  Cur = reinterpret_cast<uint8_t *>(First + 1);
+  End = reinterpret_cast<uint8_t *>(First) + First->Size;
+}
+
+} // namespace machostrip
@@ -0,0 +1,81 @@
+//
+//  Arena.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace machostrip {
+
+// monotonic allocator for the many small objects decoded out of one image.
+// memory is carved out of large blocks and only ever released all at once,
+// when the arena is destroyed or reset
+class Arena {
+public:
+  explicit Arena(size_t BlockSize = 64 << 10) : BlockSize(BlockSize) {}
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  Arena(Arena &&Other) noexcept;
+  Arena &operator=(Arena &&Other) noexcept;
+
+  void *allocate(size_t Size, size_t Align);
+
+  // copy S into the arena
+  std::string_view copy(std::string_view S);
+  // copy L followed by R into the arena
+  std::string_view concat(std::string_view L, std::string_view R);
+
+  // release everything but the first block, which is kept for reuse
+  void reset();
+
+private:
+  struct Block {
+    Block *Next;
+    size_t Size;
+  };
+
+  void grow(size_t Size, size_t Align);
+  void release(Block *B);
+
+  Block *Head = nullptr;
+  uint8_t *Cur = nullptr;
+  uint8_t *End = nullptr;
+  size_t BlockSize;
+};
+
+// standard allocator over an Arena, so containers of decoded data share the
+// arena's lifetime. deallocation is a no-op
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+
+  ArenaAllocator(Arena &A) : A(&A) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &Other) : A(Other.arena()) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(A->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *, size_t) {}
+
+  Arena *arena() const { return A; }
+
+  template <typename U> bool operator==(const ArenaAllocator<U> &R) const {
+    return A == R.arena();
+  }
+
+private:
+  Arena *A;
+};
+
+} // namespace machostrip
+
+#endif
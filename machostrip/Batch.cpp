@@ -0,0 +1,167 @@
+//
+//  Batch.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "Batch.hpp"
+#include "IO.hpp"
+#include "ThreadPool.hpp"
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace machostrip {
+
+bool read_manifest(const std::string &Path, std::vector<BatchJob> &Jobs,
+                   std::string &Error) {
+  std::ifstream file(Path);
+  if (!file) {
+    Error = "failed to open " + Path;
+    return false;
+  }
+  std::string line;
+  for (size_t lineno = 1; std::getline(file, line); lineno++) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty() || line[0] == '#')
+      continue;
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos || tab == 0 || tab + 1 == line.size()) {
+      Error = Path + ":" + std::to_string(lineno) +
+              ": expected \"input<TAB>output\"";
+      return false;
+    }
+    BatchJob Job{line.substr(0, tab), line.substr(tab + 1)};
+    if (Job.Input == "-" || Job.Output == "-") {
+      Error = Path + ":" + std::to_string(lineno) +
+              ": stdin and stdout can't be used in a manifest";
+      return false;
+    }
+    Jobs.push_back(std::move(Job));
+  }
+  return true;
+}
+
+namespace {
+
+struct Item {
+  size_t Index;
+  std::string Key;
+  std::shared_ptr<const MappedFile> File;
+};
+
+struct Result {
+  size_t Index;
+  std::string Key;
+  OutputImage Image;
+};
+
+} // namespace
+
+size_t run_batch(const std::vector<BatchJob> &Jobs,
+                 const StripOptions &Options, unsigned Threads,
+                 ResultCache *Cache) {
+  ThreadPool Pool(Threads);
+  // enough inputs in flight to keep every worker busy while the reader and
+  // the writer are blocked on the disk
+  BoundedQueue<Item> Loaded(Pool.size() * 2);
+  BoundedQueue<Result> Built(Pool.size() * 2);
+  std::vector<std::string> Errors(Jobs.size());
+
+  // inputs handed to the pool but not yet built, bounded like the queues
+  std::mutex Lock;
+  std::condition_variable Done;
+  size_t inflight = 0;
+
+  // a job whose input was already seen copies the output of the first job
+  // with that input once everything else is done
+  std::unordered_map<std::string, size_t> First;
+  std::vector<std::pair<size_t, size_t>> Duplicates;
+
+  std::thread Reader([&] {
+    for (size_t i = 0; i < Jobs.size(); i++) {
+      auto File = std::make_shared<MappedFile>();
+      if (!File->open(Jobs[i].Input)) {
+        Errors[i] = "failed to read";
+        continue;
+      }
+      std::string Key = ResultCache::key(File->data(), File->size(), Options);
+      auto [It, inserted] = First.emplace(Key, i);
+      if (!inserted) {
+        Duplicates.emplace_back(i, It->second);
+        continue;
+      }
+      if (Cache && Cache->fetch(Key, Jobs[i].Output))
+        continue;
+      Loaded.push({i, std::move(Key), std::move(File)});
+    }
+    Loaded.close();
+  });
+
+  std::thread Writer([&] {
+    while (std::optional<Result> Out = Built.pop()) {
+      const BatchJob &Job = Jobs[Out->Index];
+      bool ok = Cache ? Cache->write(Out->Key, Job.Output, Out->Image)
+                      : write_image(Job.Output, Out->Image);
+      if (!ok)
+        Errors[Out->Index] = "failed to write " + Job.Output;
+    }
+  });
+
+  while (std::optional<Item> In = Loaded.pop()) {
+    {
+      std::unique_lock<std::mutex> L(Lock);
+      Done.wait(L, [&] { return inflight < Pool.size() * 2; });
+      inflight++;
+    }
+    Pool.submit([&, In = std::make_shared<Item>(std::move(*In))] {
+      Result Out{In->Index, std::move(In->Key), {}};
+      std::string Error;
+      try {
+        if (!strip_image(In->File, Out.Image, Options, Error))
+          Errors[In->Index] = Error;
+      } catch (const std::exception &E) {
+        Errors[In->Index] = E.what();
+      }
+      In->File.reset();
+      {
+        std::lock_guard<std::mutex> L(Lock);
+        inflight--;
+      }
+      Done.notify_one();
+      if (Errors[In->Index].empty())
+        Built.push(std::move(Out));
+    });
+  }
+  Pool.wait();
+  Built.close();
+  Reader.join();
+  Writer.join();
+
+  for (auto [i, first] : Duplicates) {
+    if (!Errors[first].empty())
+      Errors[i] = Errors[first];
+    else if (!copy_file(Jobs[first].Output, Jobs[i].Output, false))
+      Errors[i] = "failed to write " + Jobs[i].Output;
+  }
+
+  size_t failed = 0;
+  for (size_t i = 0; i < Jobs.size(); i++) {
+    if (Errors[i].empty()) {
+      std::cout << "ok: " << Jobs[i].Input << " -> " << Jobs[i].Output
+                << std::endl;
+    } else {
+      std::cerr << "error: " << Jobs[i].Input << ": " << Errors[i]
+                << std::endl;
+      failed++;
+    }
+  }
+  return failed;
+}
+
+} // namespace machostrip
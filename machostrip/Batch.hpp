@@ -0,0 +1,37 @@
+//
+//  Batch.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "Cache.hpp"
+#include "Strip.hpp"
+#include <string>
+#include <vector>
+
+namespace machostrip {
+
+struct BatchJob {
+  std::string Input;
+  std::string Output;
+};
+
+// read a manifest with one "input<TAB>output" pair per line. empty lines and
+// lines starting with '#' are ignored
+bool read_manifest(const std::string &Path, std::vector<BatchJob> &Jobs,
+                   std::string &Error);
+
+// strip every job, reading, stripping and writing overlap through bounded
+// queues. jobs with identical inputs are stripped once, and with a Cache
+// inputs it already holds aren't stripped at all. a failing job is reported
+// and the others keep going. returns the number of failed jobs
+size_t run_batch(const std::vector<BatchJob> &Jobs,
+                 const StripOptions &Options, unsigned Threads,
+                 ResultCache *Cache);
+
+} // namespace machostrip
+
+#endif
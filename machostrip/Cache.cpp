@@ -0,0 +1,137 @@
+//
+//  Cache.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "Cache.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+namespace machostrip {
+
+bool ResultCache::open(std::string &Error) {
+  if (::mkdir(Dir.c_str(), 0777) == 0 || errno == EEXIST)
+    return true;
+  Error = "failed to create " + Dir;
+  return false;
+}
+
+std::string ResultCache::key(const uint8_t *Data, size_t Size,
+                             const StripOptions &Options) {
+  // every option that changes the output is part of the key
+  std::string Salt = std::string("machostrip ") + StripVersion;
+  Salt += Options.StripExt ? " strip-ext" : "";
+  Salt += Options.Fill == FillMode::Pattern ? " fill-pattern" : "";
+  Salt += Options.DeepParse ? " deep" : "";
+  Salt += Options.Rebuild ? " rebuild" : "";
+  Salt += Options.Sign ? "" : " no-sign";
+  if (Options.Seed)
+    Salt += " seed=" + std::to_string(*Options.Seed);
+  if (Options.Keep)
+    Salt += " keep=" + std::to_string(Options.Keep->Hash);
+  uint64_t seed = hash64(Salt.data(), Salt.size());
+
+  // two independent 64 bit hashes, a collision would hand out the wrong
+  // output
+  uint64_t h[2] = {hash64(Data, Size, seed), hash64(Data, Size, ~seed)};
+  static const char Digits[] = "0123456789abcdef";
+  std::string Key;
+  for (uint64_t v : h)
+    for (int shift = 60; shift >= 0; shift -= 4)
+      Key += Digits[(v >> shift) & 0xf];
+  return Key;
+}
+
+bool ResultCache::fetch(const std::string &Key,
+                        const std::string &Path) const {
+  // a copy to stdout that fails halfway can't be taken back, so stdout is
+  // never served from the cache
+  if (Path == "-")
+    return false;
+  std::string Entry = path(Key);
+  if (!copy_file(Entry, Path, Link))
+    return false;
+  // eviction goes by mtime, a hit makes the entry the most recent. a linked
+  // output shares it, so its mtime is left alone
+  if (!Link)
+    ::utimes(Entry.c_str(), nullptr);
+  return true;
+}
+
+bool ResultCache::insert(const std::string &Key, OutputImage &Image) {
+  std::string Temp = temp_path(path(Key));
+  if (!write_image(Temp, Image) ||
+      ::rename(Temp.c_str(), path(Key).c_str()) != 0) {
+    ::unlink(Temp.c_str());
+    return false;
+  }
+  evict();
+  return true;
+}
+
+bool ResultCache::write(const std::string &Key, const std::string &Path,
+                        OutputImage &Image) {
+  if (insert(Key, Image) && fetch(Key, Path))
+    return true;
+  return write_image(Path, Image);
+}
+
+void ResultCache::evict() {
+  struct Entry {
+    std::string Path;
+    uint64_t Size;
+    struct timespec MTime;
+  };
+  std::vector<Entry> Entries;
+  uint64_t total = 0;
+
+  DIR *D = ::opendir(Dir.c_str());
+  if (!D)
+    return;
+  while (struct dirent *E = ::readdir(D)) {
+    // temporary files of running inserts don't count
+    std::string Name = E->d_name;
+    if (Name.size() != 32)
+      continue;
+    std::string Path = path(Name);
+    struct stat st;
+    // an entry still linked to an output shares its blocks with it,
+    // removing it would free nothing
+    if (::stat(Path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_nlink > 1)
+      continue;
+#ifdef __APPLE__
+    Entries.push_back({Path, (uint64_t)st.st_size, st.st_mtimespec});
+#else
+    Entries.push_back({Path, (uint64_t)st.st_size, st.st_mtim});
+#endif
+    total += (uint64_t)st.st_size;
+  }
+  ::closedir(D);
+  if (total <= MaxSize)
+    return;
+
+  std::sort(Entries.begin(), Entries.end(), [](const Entry &L,
+                                               const Entry &R) {
+    if (L.MTime.tv_sec != R.MTime.tv_sec)
+      return L.MTime.tv_sec < R.MTime.tv_sec;
+    return L.MTime.tv_nsec < R.MTime.tv_nsec;
+  });
+  // another process may be evicting too, an entry that is already gone
+  // still counts as freed
+  for (const Entry &E : Entries) {
+    if (total <= MaxSize)
+      break;
+    ::unlink(E.Path.c_str());
+    total -= E.Size;
+  }
+}
+
+} // namespace machostrip
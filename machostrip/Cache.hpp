@@ -0,0 +1,62 @@
+//
+//  Cache.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include "IO.hpp"
+#include "Strip.hpp"
+#include <cstdint>
+#include <string>
+
+namespace machostrip {
+
+// directory of stripped outputs named by the hash of their input, the strip
+// options and the version. entries are only ever created by renaming a
+// complete file into place and removed by unlinking, so any number of
+// processes can share one directory
+class ResultCache {
+public:
+  // with Link a hit hard links the output to the entry where it can't be
+  // cloned. the output must then never be modified in place, that would
+  // modify the entry as well
+  ResultCache(std::string Dir, uint64_t MaxSize, bool Link = false)
+      : Dir(std::move(Dir)), MaxSize(MaxSize), Link(Link) {}
+
+  // create the directory if needed
+  bool open(std::string &Error);
+
+  // key of the result of stripping Data with Options. identical keys mean
+  // identical outputs, which is also how a batch finds duplicate inputs
+  static std::string key(const uint8_t *Data, size_t Size,
+                         const StripOptions &Options);
+
+  // produce the cached result for Key at Path, false on a miss. "-" always
+  // misses
+  bool fetch(const std::string &Key, const std::string &Path) const;
+
+  // add Image as the result for Key, then evict the least recently used
+  // entries until the cache fits in MaxSize again
+  bool insert(const std::string &Key, OutputImage &Image);
+
+  // write Image to Path and keep it as the result for Key. Path is produced
+  // from the entry like a hit, the image is written to Path directly if the
+  // entry can't be added or Path is "-"
+  bool write(const std::string &Key, const std::string &Path,
+             OutputImage &Image);
+
+private:
+  std::string path(const std::string &Key) const { return Dir + "/" + Key; }
+  void evict();
+
+  std::string Dir;
+  uint64_t MaxSize;
+  bool Link;
+};
+
+} // namespace machostrip
+
+#endif
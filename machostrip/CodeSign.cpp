@@ -0,0 +1,469 @@
+//
+//  CodeSign.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "CodeSign.hpp"
+#include "Hash.hpp"
+#include "MachOView.hpp"
+#include "Sha256.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <mach-o/loader.h>
+#include <span>
+#include <thread>
+
+namespace machostrip {
+
+namespace {
+
+// magics and slots of the embedded signature, see xnu's cs_blobs.h
+enum : uint32_t {
+  RequirementsMagic = 0xfade0c01,
+  CodeDirectoryMagic = 0xfade0c02,
+  EmbeddedSignatureMagic = 0xfade0cc0,
+  EntitlementsMagic = 0xfade7171,
+  DerEntitlementsMagic = 0xfade7172,
+};
+
+enum : uint32_t {
+  CodeDirectorySlot = 0,
+  RequirementsSlot = 2,
+  EntitlementsSlot = 5,
+  DerEntitlementsSlot = 7,
+  AlternateDirectorySlot = 0x1000,
+};
+
+enum : uint32_t {
+  AdhocFlag = 0x2,
+  LinkerSignedFlag = 0x20000,
+  ExecSegMainBinary = 0x1,
+  DirectoryVersion = 0x20400,
+  DirectoryHeaderSize = 88,
+  HashSha256 = 2,
+  HashSize = 32,
+};
+
+// what the new code directory takes over from the old one
+struct OldDirectory {
+  std::string Identifier;
+  uint32_t Flags = 0;
+  uint8_t PageShift = 0;
+  uint64_t ExecSegFlags = 0;
+  bool HasExecSeg = false;
+  bool IsSha256 = false;
+  // special slot hashes, slot 1 first. only taken over when they are SHA-256
+  std::vector<Sha256::Digest> Special;
+  // the first slot of a file outside the binary, like Info.plist, that a
+  // directory of another hash type seals. it can't be hashed again here
+  uint32_t ExternalSlot = 0;
+  // code slot hashes, only when they are SHA-256
+  std::span<const uint8_t> Code;
+  uint64_t CodeLimit = 0;
+};
+
+struct OldSignature {
+  std::optional<OldDirectory> Directory;
+  // blobs copied into the new signature, in slot order
+  std::vector<std::pair<uint32_t, std::span<const uint8_t>>> Kept;
+};
+
+// where everything goes in the new signature
+struct Layout {
+  uint8_t PageShift = 0;
+  uint64_t SpecialSlots = 0;
+  uint64_t CodeSlots = 0;
+  uint64_t HashOffset = 0;
+  uint64_t DirectorySize = 0;
+  uint64_t Size = 0;
+};
+
+} // namespace
+
+// the signature is big endian whatever the mach-o is
+static uint32_t read_be32(const uint8_t *P) {
+  return (uint32_t)P[0] << 24 | (uint32_t)P[1] << 16 | (uint32_t)P[2] << 8 |
+         P[3];
+}
+
+static uint64_t read_be64(const uint8_t *P) {
+  return (uint64_t)read_be32(P) << 32 | read_be32(P + 4);
+}
+
+static void write_be32(uint8_t *P, uint32_t Value) {
+  for (int i = 0; i < 4; i++)
+    P[i] = (uint8_t)(Value >> (24 - i * 8));
+}
+
+static void write_be64(uint8_t *P, uint64_t Value) {
+  write_be32(P, (uint32_t)(Value >> 32));
+  write_be32(P + 4, (uint32_t)Value);
+}
+
+static uint64_t align_up(uint64_t Value, uint64_t Align) {
+  return (Value + Align - 1) & ~(Align - 1);
+}
+
+static std::optional<OldDirectory>
+parse_directory(std::span<const uint8_t> CD) {
+  if (CD.size() < 44 || read_be32(CD.data()) != CodeDirectoryMagic)
+    return std::nullopt;
+  const uint8_t *P = CD.data();
+  uint32_t version = read_be32(P + 8);
+  uint32_t hashoff = read_be32(P + 16);
+  uint32_t identoff = read_be32(P + 20);
+  uint32_t nspecial = read_be32(P + 24);
+  uint32_t ncode = read_be32(P + 28);
+  uint8_t hashsize = P[36], hashtype = P[37];
+
+  OldDirectory D;
+  D.Flags = read_be32(P + 12);
+  D.PageShift = P[39];
+  D.CodeLimit = read_be32(P + 32);
+  if (identoff >= CD.size())
+    return std::nullopt;
+  const uint8_t *Ident = P + identoff;
+  D.Identifier.assign((const char *)Ident,
+                      strnlen((const char *)Ident, CD.size() - identoff));
+  if (version >= DirectoryVersion && CD.size() >= DirectoryHeaderSize) {
+    D.HasExecSeg = true;
+    D.ExecSegFlags = read_be64(P + 80);
+  }
+  D.IsSha256 = hashtype == HashSha256 && hashsize == HashSize;
+  if (D.IsSha256 && hashoff <= CD.size() &&
+      (uint64_t)nspecial * HashSize <= hashoff) {
+    D.Special.resize(nspecial);
+    for (uint32_t i = 0; i < nspecial; i++)
+      std::memcpy(D.Special[i].data(), P + hashoff - (i + 1) * HashSize,
+                  HashSize);
+    if ((uint64_t)ncode * HashSize <= CD.size() - hashoff)
+      D.Code = CD.subspan(hashoff, (size_t)ncode * HashSize);
+  } else if (hashsize && hashoff <= CD.size() &&
+             (uint64_t)nspecial * hashsize <= hashoff) {
+    for (uint32_t slot = 1; slot <= nspecial && !D.ExternalSlot; slot++) {
+      const uint8_t *Hash = P + hashoff - slot * hashsize;
+      if (slot != RequirementsSlot && slot != EntitlementsSlot &&
+          slot != DerEntitlementsSlot &&
+          std::any_of(Hash, Hash + hashsize, [](uint8_t b) { return b; }))
+        D.ExternalSlot = slot;
+    }
+  }
+  return D;
+}
+
+static bool parse_signature(std::span<const uint8_t> Sig, OldSignature &Old) {
+  if (Sig.size() < 12 || read_be32(Sig.data()) != EmbeddedSignatureMagic)
+    return false;
+  uint32_t length = std::min<uint64_t>(read_be32(Sig.data() + 4), Sig.size());
+  uint32_t count = read_be32(Sig.data() + 8);
+  if ((uint64_t)count * 8 + 12 > length)
+    return false;
+
+  std::optional<OldDirectory> OtherDirectory;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t slot = read_be32(Sig.data() + 12 + i * 8);
+    uint32_t off = read_be32(Sig.data() + 16 + i * 8);
+    if (off + 8ULL > length)
+      return false;
+    uint32_t size = read_be32(Sig.data() + off + 4);
+    if (size < 8 || off + (uint64_t)size > length)
+      return false;
+    std::span<const uint8_t> B = Sig.subspan(off, size);
+
+    if (slot == CodeDirectorySlot ||
+        (slot >= AlternateDirectorySlot && slot < AlternateDirectorySlot + 5)) {
+      // prefer the SHA-256 directory, older tools put a SHA-1 one first
+      std::optional<OldDirectory> D = parse_directory(B);
+      if (D && D->IsSha256 && !Old.Directory)
+        Old.Directory = std::move(D);
+      else if (D && !OtherDirectory)
+        OtherDirectory = std::move(D);
+    } else if (slot == RequirementsSlot || slot == EntitlementsSlot ||
+               slot == DerEntitlementsSlot) {
+      Old.Kept.push_back({slot, B});
+    }
+  }
+  if (!Old.Directory)
+    Old.Directory = std::move(OtherDirectory);
+  std::sort(Old.Kept.begin(), Old.Kept.end(),
+            [](const auto &L, const auto &R) { return L.first < R.first; });
+  return Old.Directory.has_value();
+}
+
+// hash every page of the first Limit bytes Read returns into Slots. Reuse
+// may fill in the slot of page i instead and return true
+static void hash_slots(const PageReader &Read, uint64_t Limit,
+                       uint64_t PageSize, uint8_t *Slots,
+                       const std::function<bool(size_t, uint8_t *)> &Reuse) {
+  size_t npages = (size_t)((Limit + PageSize - 1) / PageSize);
+  // reused pages cost next to nothing and the changed ones cluster at both
+  // ends, so the pages are handed out in small batches rather than as one
+  // contiguous run per thread
+  const size_t Batch = 16;
+  std::atomic<size_t> Next{0};
+  auto Work = [&] {
+    std::vector<uint8_t> Scratch;
+    for (;;) {
+      size_t begin = Next.fetch_add(Batch);
+      if (begin >= npages)
+        return;
+      for (size_t i = begin; i < std::min(begin + Batch, npages); i++) {
+        uint8_t *Slot = Slots + i * HashSize;
+        if (Reuse && Reuse(i, Slot))
+          continue;
+        uint64_t off = i * PageSize;
+        std::span<const uint8_t> Page =
+            Read(off, (size_t)std::min(PageSize, Limit - off), Scratch);
+        Sha256::Digest D = Sha256::hash(Page.data(), Page.size());
+        std::memcpy(Slot, D.data(), HashSize);
+      }
+    }
+  };
+
+  size_t nthreads = std::min<size_t>(
+      std::max(1U, std::thread::hardware_concurrency()), npages / 64 + 1);
+  std::vector<std::thread> Threads;
+  for (size_t t = 1; t < nthreads; t++)
+    Threads.emplace_back(Work);
+  Work();
+  for (std::thread &T : Threads)
+    T.join();
+}
+
+// lay out the signature that replaces Old once the signed content ends at
+// CodeLimit. code directory: header, identifier, special slots in reverse
+// order and one hash per page. then the kept blobs
+static Layout plan_layout(const OldSignature &Old, uint32_t CpuType,
+                          uint64_t CodeLimit) {
+  const OldDirectory &OldCD = *Old.Directory;
+  Layout L;
+  L.PageShift = OldCD.PageShift;
+  if (L.PageShift < 12 || L.PageShift > 16)
+    L.PageShift = segment_page_size(CpuType) == 0x4000 ? 14 : 12;
+  uint64_t pagesize = 1ULL << L.PageShift;
+
+  L.SpecialSlots = OldCD.Special.size();
+  for (const auto &Kept : Old.Kept)
+    L.SpecialSlots = std::max<uint64_t>(L.SpecialSlots, Kept.first);
+  L.CodeSlots = (CodeLimit + pagesize - 1) / pagesize;
+  L.HashOffset = DirectoryHeaderSize + OldCD.Identifier.size() + 1 +
+                 L.SpecialSlots * HashSize;
+  L.DirectorySize = L.HashOffset + L.CodeSlots * HashSize;
+
+  L.Size = 12 + (1 + Old.Kept.size()) * 8 + L.DirectorySize;
+  for (const auto &Kept : Old.Kept)
+    L.Size += Kept.second.size();
+  return L;
+}
+
+// the code signature blob of View, if it has one
+static const Blob *find_signature(const MachOView &View) {
+  for (const Blob &B : View.blobs())
+    if (B.K == Blob::Data && B.Cmd == LC_CODE_SIGNATURE)
+      return &B;
+  return nullptr;
+}
+
+bool adhoc_sign(SliceImage &Image, const SignBase *Base, std::string &Error) {
+  // every load command is in Head, which is all the view reads
+  MachOView View(Image.Head.data(), Image.size());
+  const Blob *Signature = find_signature(View);
+  if (!Signature)
+    return true;
+
+  // the signature has to be the last thing in the file, it is resized
+  auto Linkedit = std::find_if(
+      View.segments().begin(), View.segments().end(),
+      [](const Segment &Seg) { return Seg.Name == "__LINKEDIT"; });
+  uint64_t codelimit = Signature->Offset;
+  if (Linkedit == View.segments().end() || codelimit < Linkedit->FileOff ||
+      codelimit < Image.end_piece_offset() || codelimit % 16) {
+    Error = "code signature outside of __LINKEDIT";
+    return false;
+  }
+  for (const Blob &B : View.blobs()) {
+    if (&B != Signature && B.Offset + B.Size > codelimit) {
+      Error = "code signature is not the last LINKEDIT data";
+      return false;
+    }
+  }
+  for (const Segment &Seg : View.segments()) {
+    if (&Seg != &*Linkedit && Seg.FileSize &&
+        Seg.FileOff + Seg.FileSize > codelimit) {
+      Error = "__LINKEDIT is not the last segment";
+      return false;
+    }
+  }
+
+  // the old hashes are only meaningful for the content they were made from,
+  // so with a Base the signature is read from there
+  std::vector<uint8_t> OldScratch;
+  std::span<const uint8_t> OldSig =
+      Image.read(Signature->Offset, Signature->Size, OldScratch);
+  MachOView BaseView(Base ? Base->Data.data() : nullptr,
+                     Base ? Base->Data.size() : 0);
+  const Blob *BaseSignature = Base ? find_signature(BaseView) : nullptr;
+  if (BaseSignature)
+    OldSig = Base->Data.subspan(BaseSignature->Offset, BaseSignature->Size);
+  else
+    Base = nullptr;
+
+  OldSignature Old;
+  if (!parse_signature(OldSig, Old)) {
+    Error = "malformed code signature";
+    return false;
+  }
+  const OldDirectory &OldCD = *Old.Directory;
+  if (OldCD.ExternalSlot) {
+    Error = "code signature seals special slot " +
+            std::to_string(OldCD.ExternalSlot) + " without SHA-256";
+    return false;
+  }
+  Layout L = plan_layout(Old, View.cpu_type(), codelimit);
+  uint8_t pageshift = L.PageShift;
+  uint64_t pagesize = 1ULL << pageshift;
+  uint64_t nspecial = L.SpecialSlots, ncode = L.CodeSlots;
+  uint64_t identoff = DirectoryHeaderSize, hashoff = L.HashOffset;
+  uint64_t cdsize = L.DirectorySize, sigsize = L.Size;
+  uint64_t nblobs = 1 + Old.Kept.size();
+
+  // special slot i is the hash of the kept blob of slot i. slots of files
+  // outside the binary, like Info.plist, keep their old hash
+  std::vector<Sha256::Digest> Special = OldCD.Special;
+  Special.resize(nspecial, Sha256::Digest{});
+  for (const auto &[slot, B] : Old.Kept)
+    Special[slot - 1] = Sha256::hash(B.data(), B.size());
+
+  if (codelimit + sigsize > UINT32_MAX) {
+    Error = "too large to sign";
+    return false;
+  }
+
+  // the load commands are part of the first page, so they are final before
+  // anything is hashed
+  uint64_t end = codelimit + align_up(sigsize, 16);
+  uint8_t *Out = Image.Head.data();
+  linkedit_data_command LD =
+      read<linkedit_data_command>(Out + Signature->CmdOffset);
+  LD.datasize = (uint32_t)(end - codelimit);
+  write(Out + Signature->CmdOffset, LD);
+
+  uint64_t filesize = end - Linkedit->FileOff;
+  uint64_t page = segment_page_size(View.cpu_type());
+  uint64_t vmsize = std::max(Linkedit->VMSize, align_up(filesize, page));
+  uint8_t *P = Out + Linkedit->CmdOffset;
+  if (View.is64()) {
+    segment_command_64 Seg = read<segment_command_64>(P);
+    Seg.filesize = filesize;
+    Seg.vmsize = vmsize;
+    write(P, Seg);
+  } else {
+    segment_command Seg = read<segment_command>(P);
+    Seg.filesize = (uint32_t)filesize;
+    Seg.vmsize = (uint32_t)vmsize;
+    write(P, Seg);
+  }
+
+  // the kept blobs point into the old signature, copy them out before the
+  // image is resized
+  std::vector<uint8_t> Sig(sigsize);
+  uint8_t *S = Sig.data();
+  write_be32(S, EmbeddedSignatureMagic);
+  write_be32(S + 4, (uint32_t)sigsize);
+  write_be32(S + 8, (uint32_t)nblobs);
+  uint64_t off = 12 + nblobs * 8;
+  write_be32(S + 12, CodeDirectorySlot);
+  write_be32(S + 16, (uint32_t)off);
+  uint8_t *CD = S + off;
+  off += cdsize;
+  for (size_t i = 0; i < Old.Kept.size(); i++) {
+    const auto &[slot, B] = Old.Kept[i];
+    write_be32(S + 20 + i * 8, slot);
+    write_be32(S + 24 + i * 8, (uint32_t)off);
+    std::memcpy(S + off, B.data(), B.size());
+    off += B.size();
+  }
+
+  uint64_t execbase = 0, execlimit = 0;
+  for (const Segment &Seg : View.segments()) {
+    if (Seg.Name == "__TEXT") {
+      execbase = Seg.FileOff;
+      execlimit = Seg.FileSize;
+    }
+  }
+  uint64_t execflags = OldCD.ExecSegFlags;
+  if (!OldCD.HasExecSeg && View.file_type() == MH_EXECUTE)
+    execflags = ExecSegMainBinary;
+
+  write_be32(CD, CodeDirectoryMagic);
+  write_be32(CD + 4, (uint32_t)cdsize);
+  write_be32(CD + 8, DirectoryVersion);
+  write_be32(CD + 12, (OldCD.Flags & ~LinkerSignedFlag) | AdhocFlag);
+  write_be32(CD + 16, (uint32_t)hashoff);
+  write_be32(CD + 20, (uint32_t)identoff);
+  write_be32(CD + 24, (uint32_t)nspecial);
+  write_be32(CD + 28, (uint32_t)ncode);
+  write_be32(CD + 32, (uint32_t)codelimit);
+  CD[36] = HashSize;
+  CD[37] = HashSha256;
+  CD[38] = 0;
+  CD[39] = pageshift;
+  write_be64(CD + 64, execbase);
+  write_be64(CD + 72, execlimit);
+  write_be64(CD + 80, execflags);
+  std::memcpy(CD + identoff, OldCD.Identifier.c_str(),
+              OldCD.Identifier.size() + 1);
+  for (uint64_t i = 0; i < nspecial; i++)
+    std::memcpy(CD + hashoff - (i + 1) * HashSize, Special[i].data(),
+                HashSize);
+
+  // a page with the same bytes at the same offset as in Base keeps its old
+  // hash. the size has to match too, the last page may have grown
+  std::function<bool(size_t, uint8_t *)> Reuse;
+  if (Base && !OldCD.Code.empty() && OldCD.PageShift == pageshift) {
+    Reuse = [&](size_t i, uint8_t *Slot) {
+      uint64_t begin = i * pagesize;
+      uint64_t size = std::min(pagesize, codelimit - begin);
+      if ((i + 1) * HashSize > OldCD.Code.size() ||
+          begin >= OldCD.CodeLimit ||
+          std::min(pagesize, OldCD.CodeLimit - begin) != size ||
+          begin + size > Base->Data.size())
+        return false;
+      bool clean = begin >= Base->CleanBegin && begin + size <= Base->CleanEnd;
+      std::vector<uint8_t> Scratch;
+      if (!clean && std::memcmp(Image.read(begin, size, Scratch).data(),
+                                Base->Data.data() + begin, size))
+        return false;
+      std::memcpy(Slot, OldCD.Code.data() + i * HashSize, HashSize);
+      return true;
+    };
+  }
+
+  Image.resize(end);
+  uint8_t *Dest = Image.data(codelimit, end - codelimit);
+  std::copy(Sig.begin(), Sig.end(), Dest);
+  std::fill(Dest + sigsize, Dest + (end - codelimit), 0);
+  auto Read = [&](uint64_t Offset, size_t Size,
+                  std::vector<uint8_t> &PageScratch) {
+    return Image.read(Offset, Size, PageScratch);
+  };
+  hash_slots(Read, codelimit, pagesize, Dest + (CD - S) + hashoff, Reuse);
+  return true;
+}
+
+uint64_t adhoc_signature_size(const uint8_t *Data, size_t Size,
+                              uint64_t CodeLimit) {
+  MachOView View(Data, Size);
+  const Blob *Signature = find_signature(View);
+  OldSignature Old;
+  if (!Signature ||
+      !parse_signature({Data + Signature->Offset, Signature->Size}, Old))
+    return 0;
+  return align_up(plan_layout(Old, View.cpu_type(), CodeLimit).Size, 16);
+}
+
+} // namespace machostrip
@@ -0,0 +1,46 @@
+//
+//  CodeSign.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef CODESIGN_HPP
+#define CODESIGN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace machostrip {
+
+struct SliceImage;
+
+// the thin mach-o a signed image was derived from
+struct SignBase {
+  std::span<const uint8_t> Data;
+  // range of the signed image known to hold the same bytes as Data, its
+  // pages are taken over without comparing them
+  uint64_t CleanBegin = 0;
+  uint64_t CleanEnd = 0;
+};
+
+// replace the code signature of the thin mach-o in Image with an ad-hoc one,
+// like codesign -s - does. the requirements and entitlements of the old
+// signature are kept, its CMS signature is dropped. the pages are hashed
+// with SHA-256 on several threads. with a Base, the signature is taken from
+// Base and every page that is the same as in Base keeps its old hash, so
+// only the changed pages are hashed. Image is resized to the new signature,
+// an image without LC_CODE_SIGNATURE is left alone
+bool adhoc_sign(SliceImage &Image, const SignBase *Base, std::string &Error);
+
+// the size adhoc_sign gives the signature of the thin mach-o at Data when
+// the signed content ends at CodeLimit, so the output can be allocated
+// before it is built. 0 when Data has no signature it can replace
+uint64_t adhoc_signature_size(const uint8_t *Data, size_t Size,
+                              uint64_t CodeLimit);
+
+} // namespace machostrip
+
+#endif
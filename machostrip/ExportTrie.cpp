@@ -0,0 +1,249 @@
+//
+//  ExportTrie.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "ExportTrie.hpp"
+#include <cstring>
+#include <string_view>
+
+namespace machostrip {
+
+// flags of an export trie terminal
+static constexpr uint64_t ExportReexport = 0x08;
+static constexpr uint64_t ExportStubAndResolver = 0x10;
+
+bool read_uleb(const uint8_t *&P, const uint8_t *End, uint64_t &Value) {
+  Value = 0;
+  for (unsigned shift = 0; P < End; shift += 7) {
+    uint8_t byte = *P++;
+    if (shift < 64)
+      Value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool read_sleb(const uint8_t *&P, const uint8_t *End, int64_t &Value) {
+  uint64_t value = 0;
+  for (unsigned shift = 0; P < End; shift += 7) {
+    uint8_t byte = *P++;
+    if (shift < 64)
+      value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      // sign extend from the last byte
+      if ((byte & 0x40) && shift + 7 < 64)
+        value |= ~(uint64_t)0 << (shift + 7);
+      Value = (int64_t)value;
+      return true;
+    }
+  }
+  return false;
+}
+
+void write_uleb(std::vector<uint8_t> &Out, uint64_t Value) {
+  do {
+    uint8_t byte = Value & 0x7f;
+    Value >>= 7;
+    Out.push_back(Value ? byte | 0x80 : byte);
+  } while (Value);
+}
+
+static size_t uleb_size(uint64_t Value) {
+  size_t n = 1;
+  while (Value >>= 7)
+    n++;
+  return n;
+}
+
+std::vector<RawExport> parse_export_trie(std::span<const uint8_t> Trie,
+                                         Arena &A) {
+  std::vector<RawExport> Exports;
+  if (Trie.empty())
+    return Exports;
+
+  // every node is visited at most once, which also stops malformed tries
+  // whose edges loop back
+  std::vector<bool> Visited(Trie.size());
+  struct Pending {
+    uint64_t Offset;
+    std::string_view Prefix;
+  };
+  std::vector<Pending> Stack{{0, {}}};
+  const uint8_t *Begin = Trie.data(), *End = Trie.data() + Trie.size();
+
+  while (!Stack.empty()) {
+    Pending Node = Stack.back();
+    Stack.pop_back();
+    if (Node.Offset >= Trie.size() || Visited[Node.Offset])
+      continue;
+    Visited[Node.Offset] = true;
+
+    const uint8_t *P = Begin + Node.Offset;
+    uint64_t terminalsize;
+    if (!read_uleb(P, End, terminalsize) || terminalsize > (uint64_t)(End - P))
+      continue;
+    const uint8_t *Children = P + terminalsize;
+    if (terminalsize) {
+      RawExport E;
+      E.Name = Node.Prefix;
+      if (read_uleb(P, Children, E.Flags)) {
+        if (E.Flags & ExportReexport) {
+          read_uleb(P, Children, E.Value);
+          E.ImportName = {(const char *)P,
+                          strnlen((const char *)P, Children - P)};
+        } else if (read_uleb(P, Children, E.Value) &&
+                   (E.Flags & ExportStubAndResolver)) {
+          read_uleb(P, Children, E.Other);
+        }
+        Exports.push_back(E);
+      }
+    }
+
+    P = Children;
+    if (P >= End)
+      continue;
+    uint8_t count = *P++;
+    for (uint8_t i = 0; i < count && P < End; i++) {
+      size_t len = strnlen((const char *)P, End - P);
+      std::string_view Edge((const char *)P, len);
+      P += len + 1;
+      uint64_t child;
+      if (P > End || !read_uleb(P, End, child))
+        break;
+      Stack.push_back({child, A.concat(Node.Prefix, Edge)});
+    }
+  }
+  return Exports;
+}
+
+namespace {
+
+// an edge label is a substring of the name that created it
+struct TrieEdge {
+  std::string_view Label;
+  size_t Child;
+};
+
+struct TrieNode {
+  explicit TrieNode(Arena &A) : Edges(A) {}
+
+  std::vector<TrieEdge, ArenaAllocator<TrieEdge>> Edges;
+  const RawExport *Export = nullptr;
+  uint64_t Offset = 0;
+  // range of the encoded terminal in the shared terminal buffer
+  size_t TerminalBegin = 0;
+  size_t TerminalSize = 0;
+};
+
+} // namespace
+
+static void encode_terminal(std::vector<uint8_t> &Out, const RawExport &E) {
+  write_uleb(Out, E.Flags);
+  if (E.Flags & ExportReexport) {
+    write_uleb(Out, E.Value);
+    Out.insert(Out.end(), E.ImportName.begin(), E.ImportName.end());
+    Out.push_back(0);
+    return;
+  }
+  write_uleb(Out, E.Value);
+  if (E.Flags & ExportStubAndResolver)
+    write_uleb(Out, E.Other);
+}
+
+std::vector<uint8_t> encode_export_trie(const std::vector<RawExport> &Exports) {
+  // the nodes and their edge lists all die together at the end
+  Arena A;
+  std::vector<TrieNode, ArenaAllocator<TrieNode>> Nodes(A);
+  Nodes.reserve(Exports.size() * 2 + 1);
+  Nodes.emplace_back(A);
+  for (const RawExport &E : Exports) {
+    size_t cur = 0;
+    std::string_view Rest = E.Name;
+    while (!Rest.empty()) {
+      auto &Edges = Nodes[cur].Edges;
+      size_t i = 0;
+      while (i < Edges.size() && Edges[i].Label[0] != Rest[0])
+        i++;
+      if (i == Edges.size()) {
+        Edges.push_back({Rest, Nodes.size()});
+        cur = Nodes.size();
+        Nodes.emplace_back(A);
+        break;
+      }
+      std::string_view Label = Edges[i].Label;
+      size_t k = 1;
+      while (k < Label.size() && k < Rest.size() && Label[k] == Rest[k])
+        k++;
+      if (k < Label.size()) {
+        // split the edge at the end of the common prefix
+        size_t mid = Nodes.size();
+        TrieNode Mid(A);
+        Mid.Edges.push_back({Label.substr(k), Edges[i].Child});
+        Edges[i] = {Label.substr(0, k), mid};
+        Nodes.push_back(std::move(Mid));
+      }
+      cur = Nodes[cur].Edges[i].Child;
+      Rest.remove_prefix(k);
+    }
+    if (!Nodes[cur].Export)
+      Nodes[cur].Export = &E;
+  }
+
+  // pre-order, children in insertion order
+  std::vector<size_t> Order;
+  std::vector<size_t> Stack{0};
+  while (!Stack.empty()) {
+    size_t n = Stack.back();
+    Stack.pop_back();
+    Order.push_back(n);
+    for (auto It = Nodes[n].Edges.rbegin(); It != Nodes[n].Edges.rend(); ++It)
+      Stack.push_back(It->Child);
+  }
+
+  std::vector<uint8_t> Terminals;
+  for (TrieNode &Node : Nodes) {
+    if (!Node.Export)
+      continue;
+    Node.TerminalBegin = Terminals.size();
+    encode_terminal(Terminals, *Node.Export);
+    Node.TerminalSize = Terminals.size() - Node.TerminalBegin;
+  }
+
+  // child offsets are ulebs, so moving one node can grow its parent. repeat
+  // until the layout is stable, offsets only ever grow so this terminates
+  for (bool changed = true; changed;) {
+    changed = false;
+    uint64_t off = 0;
+    for (size_t n : Order) {
+      TrieNode &Node = Nodes[n];
+      if (Node.Offset != off) {
+        Node.Offset = off;
+        changed = true;
+      }
+      off += uleb_size(Node.TerminalSize) + Node.TerminalSize + 1;
+      for (const TrieEdge &E : Node.Edges)
+        off += E.Label.size() + 1 + uleb_size(Nodes[E.Child].Offset);
+    }
+  }
+
+  std::vector<uint8_t> Out;
+  for (size_t n : Order) {
+    const TrieNode &Node = Nodes[n];
+    auto Terminal = Terminals.begin() + Node.TerminalBegin;
+    write_uleb(Out, Node.TerminalSize);
+    Out.insert(Out.end(), Terminal, Terminal + Node.TerminalSize);
+    Out.push_back((uint8_t)Node.Edges.size());
+    for (const TrieEdge &E : Node.Edges) {
+      Out.insert(Out.end(), E.Label.begin(), E.Label.end());
+      Out.push_back(0);
+      write_uleb(Out, Nodes[E.Child].Offset);
+    }
+  }
+  Out.resize((Out.size() + 7) & ~(size_t)7);
+  return Out;
+}
+
+} // namespace machostrip
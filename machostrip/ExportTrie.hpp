@@ -0,0 +1,50 @@
+//
+//  ExportTrie.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef EXPORTTRIE_HPP
+#define EXPORTTRIE_HPP
+
+#include "Arena.hpp"
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace machostrip {
+
+// a terminal node of the export trie. the names point into the arena and
+// the trie they were decoded from
+struct RawExport {
+  std::string_view Name;
+  uint64_t Flags = 0;
+  // address, or the ordinal of a re-export
+  uint64_t Value = 0;
+  // resolver of a stub and resolver export
+  uint64_t Other = 0;
+  std::string_view ImportName;
+};
+
+// decode an unsigned LEB128 at P, advancing it. false on overrun
+bool read_uleb(const uint8_t *&P, const uint8_t *End, uint64_t &Value);
+
+// decode a signed LEB128 at P, advancing it. false on overrun
+bool read_sleb(const uint8_t *&P, const uint8_t *End, int64_t &Value);
+
+// append Value as an unsigned LEB128
+void write_uleb(std::vector<uint8_t> &Out, uint64_t Value);
+
+// decode every terminal of an export trie, the names are built in A
+std::vector<RawExport> parse_export_trie(std::span<const uint8_t> Trie,
+                                         Arena &A);
+
+// build an export trie the way ld64 lays it out: nodes in pre-order and the
+// offsets iterated until every uleb is stable. the result is padded to 8
+// bytes. when a name is exported twice the first one wins
+std::vector<uint8_t> encode_export_trie(const std::vector<RawExport> &Exports);
+
+} // namespace machostrip
+
+#endif
@@ -0,0 +1,165 @@
+//
+//  Fixups.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "Fixups.hpp"
+#include "ExportTrie.hpp"
+#include <cstring>
+#include <mach-o/loader.h>
+
+namespace machostrip {
+
+namespace {
+
+// the address the opcodes are pointing at. every write has to land inside
+// the current segment, which also bounds the repeat counts of malformed
+// opcodes
+struct Cursor {
+  const std::vector<Segment> &Segments;
+  const Segment *Seg = nullptr;
+  uint64_t Offset = 0;
+
+  bool set(uint64_t Index, uint64_t Off) {
+    Seg = Index < Segments.size() ? &Segments[Index] : nullptr;
+    Offset = Off;
+    return Seg;
+  }
+  bool valid() const { return Seg && Offset < Seg->VMSize; }
+  uint64_t address() const { return Seg->VMAddr + Offset; }
+};
+
+} // namespace
+
+void decode_rebases(std::span<const uint8_t> Opcodes,
+                    const std::vector<Segment> &Segments, bool Is64,
+                    std::vector<uint64_t> &Addresses) {
+  const uint8_t *P = Opcodes.data(), *End = P + Opcodes.size();
+  uint64_t ptrsize = Is64 ? 8 : 4;
+  Cursor C{Segments};
+
+  auto Emit = [&](uint64_t Count, uint64_t Skip) {
+    for (uint64_t i = 0; i < Count; i++) {
+      if (!C.valid())
+        return false;
+      Addresses.push_back(C.address());
+      C.Offset += ptrsize + Skip;
+    }
+    return true;
+  };
+
+  while (P < End) {
+    uint8_t opcode = *P & REBASE_OPCODE_MASK;
+    uint8_t imm = *P & REBASE_IMMEDIATE_MASK;
+    P++;
+    uint64_t a, b;
+    bool ok = true;
+    switch (opcode) {
+    case REBASE_OPCODE_DONE:
+      return;
+    case REBASE_OPCODE_SET_TYPE_IMM:
+      break;
+    case REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB:
+      ok = read_uleb(P, End, a) && C.set(imm, a);
+      break;
+    case REBASE_OPCODE_ADD_ADDR_ULEB:
+      ok = read_uleb(P, End, a);
+      C.Offset += a;
+      break;
+    case REBASE_OPCODE_ADD_ADDR_IMM_SCALED:
+      C.Offset += imm * ptrsize;
+      break;
+    case REBASE_OPCODE_DO_REBASE_IMM_TIMES:
+      ok = Emit(imm, 0);
+      break;
+    case REBASE_OPCODE_DO_REBASE_ULEB_TIMES:
+      ok = read_uleb(P, End, a) && Emit(a, 0);
+      break;
+    case REBASE_OPCODE_DO_REBASE_ADD_ADDR_ULEB:
+      ok = read_uleb(P, End, a) && Emit(1, a);
+      break;
+    case REBASE_OPCODE_DO_REBASE_ULEB_TIMES_SKIPPING_ULEB:
+      ok = read_uleb(P, End, a) && read_uleb(P, End, b) && Emit(a, b);
+      break;
+    default:
+      ok = false;
+    }
+    if (!ok)
+      return;
+  }
+}
+
+void decode_bindings(std::span<const uint8_t> Opcodes,
+                     const std::vector<Segment> &Segments, bool Is64,
+                     bool Lazy, std::vector<uint64_t> &Addresses) {
+  const uint8_t *P = Opcodes.data(), *End = P + Opcodes.size();
+  uint64_t ptrsize = Is64 ? 8 : 4;
+  Cursor C{Segments};
+
+  auto Emit = [&](uint64_t Count, uint64_t Skip) {
+    for (uint64_t i = 0; i < Count; i++) {
+      if (!C.valid())
+        return false;
+      Addresses.push_back(C.address());
+      C.Offset += ptrsize + Skip;
+    }
+    return true;
+  };
+
+  while (P < End) {
+    uint8_t opcode = *P & BIND_OPCODE_MASK;
+    uint8_t imm = *P & BIND_IMMEDIATE_MASK;
+    P++;
+    uint64_t a, b;
+    int64_t addend;
+    bool ok = true;
+    switch (opcode) {
+    case BIND_OPCODE_DONE:
+      // lazy bindings are separated by DONE, the others end at it
+      if (!Lazy)
+        return;
+      break;
+    case BIND_OPCODE_SET_DYLIB_ORDINAL_IMM:
+    case BIND_OPCODE_SET_DYLIB_SPECIAL_IMM:
+    case BIND_OPCODE_SET_TYPE_IMM:
+      break;
+    case BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB:
+      ok = read_uleb(P, End, a);
+      break;
+    case BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM:
+      P += strnlen((const char *)P, End - P) + 1;
+      ok = P <= End;
+      break;
+    case BIND_OPCODE_SET_ADDEND_SLEB:
+      ok = read_sleb(P, End, addend);
+      break;
+    case BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB:
+      ok = read_uleb(P, End, a) && C.set(imm, a);
+      break;
+    case BIND_OPCODE_ADD_ADDR_ULEB:
+      ok = read_uleb(P, End, a);
+      C.Offset += a;
+      break;
+    case BIND_OPCODE_DO_BIND:
+      ok = Emit(1, 0);
+      break;
+    case BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB:
+      ok = read_uleb(P, End, a) && Emit(1, a);
+      break;
+    case BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED:
+      ok = Emit(1, imm * ptrsize);
+      break;
+    case BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB:
+      ok = read_uleb(P, End, a) && read_uleb(P, End, b) && Emit(a, b);
+      break;
+    default:
+      // threaded binds are chained fixups in disguise, not decoded here
+      ok = false;
+    }
+    if (!ok)
+      return;
+  }
+}
+
+} // namespace machostrip
@@ -0,0 +1,33 @@
+//
+//  Fixups.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef FIXUPS_HPP
+#define FIXUPS_HPP
+
+#include "MachOFile.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace machostrip {
+
+// decode LC_DYLD_INFO rebase opcodes into the addresses of the pointers
+// dyld slides, in opcode order. Segments are the segments of the image in
+// load command order. decoding stops at the first malformed opcode. only
+// -info reads them, the strip never edits the opcodes
+void decode_rebases(std::span<const uint8_t> Opcodes,
+                    const std::vector<Segment> &Segments, bool Is64,
+                    std::vector<uint64_t> &Addresses);
+
+// decode bind, weak bind or lazy bind opcodes into the addresses of the
+// pointers dyld binds. Lazy opcodes are separated by DONE
+void decode_bindings(std::span<const uint8_t> Opcodes,
+                     const std::vector<Segment> &Segments, bool Is64,
+                     bool Lazy, std::vector<uint64_t> &Addresses);
+
+} // namespace machostrip
+
+#endif
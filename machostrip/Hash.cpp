@@ -0,0 +1,126 @@
+//
+//  Hash.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "Hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace machostrip {
+
+static constexpr uint64_t Prime1 = 11400714785074694791ULL;
+static constexpr uint64_t Prime2 = 14029467366897019727ULL;
+static constexpr uint64_t Prime3 = 1609587929392839161ULL;
+static constexpr uint64_t Prime4 = 9650029242287828579ULL;
+static constexpr uint64_t Prime5 = 2870177450012600261ULL;
+
+static uint64_t rotl(uint64_t X, int R) { return (X << R) | (X >> (64 - R)); }
+
+template <typename T> static T load(const uint8_t *P) {
+  T V;
+  std::memcpy(&V, P, sizeof(T));
+  return V;
+}
+
+static uint64_t round(uint64_t Acc, uint64_t Input) {
+  Acc += Input * Prime2;
+  return rotl(Acc, 31) * Prime1;
+}
+
+static uint64_t merge(uint64_t Acc, uint64_t Val) {
+  Acc ^= round(0, Val);
+  return Acc * Prime1 + Prime4;
+}
+
+uint64_t hash64(const void *Data, size_t Size, uint64_t Seed) {
+  const uint8_t *P = static_cast<const uint8_t *>(Data);
+  const uint8_t *End = P + Size;
+  uint64_t h;
+
+  if (Size >= 32) {
+    uint64_t v1 = Seed + Prime1 + Prime2;
+    uint64_t v2 = Seed + Prime2;
+    uint64_t v3 = Seed;
+    uint64_t v4 = Seed - Prime1;
+    // four independent lanes, 32 bytes per iteration
+    for (; End - P >= 32; P += 32) {
+      v1 = round(v1, load<uint64_t>(P));
+      v2 = round(v2, load<uint64_t>(P + 8));
+      v3 = round(v3, load<uint64_t>(P + 16));
+      v4 = round(v4, load<uint64_t>(P + 24));
+    }
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = merge(h, v1);
+    h = merge(h, v2);
+    h = merge(h, v3);
+    h = merge(h, v4);
+  } else {
+    h = Seed + Prime5;
+  }
+  h += (uint64_t)Size;
+
+  for (; End - P >= 8; P += 8)
+    h = rotl(h ^ round(0, load<uint64_t>(P)), 27) * Prime1 + Prime4;
+  if (End - P >= 4) {
+    h = rotl(h ^ (load<uint32_t>(P) * Prime1), 23) * Prime2 + Prime3;
+    P += 4;
+  }
+  for (; P < End; P++)
+    h = rotl(h ^ (*P * Prime5), 11) * Prime1;
+
+  h ^= h >> 33;
+  h *= Prime2;
+  h ^= h >> 29;
+  h *= Prime3;
+  h ^= h >> 32;
+  return h;
+}
+
+std::array<uint8_t, 16> hash_pages(const uint8_t *Data, size_t Size,
+                                   size_t PageSize) {
+  return hash_pages(Size, PageSize,
+                    [&](uint64_t Offset, size_t PageBytes,
+                        std::vector<uint8_t> &) {
+                      return std::span<const uint8_t>(Data + Offset,
+                                                      PageBytes);
+                    });
+}
+
+std::array<uint8_t, 16> hash_pages(uint64_t Size, size_t PageSize,
+                                   const PageReader &Read) {
+  size_t npages = (size_t)((Size + PageSize - 1) / PageSize);
+  std::vector<uint64_t> Pages(npages);
+  auto Work = [&](size_t begin, size_t end) {
+    std::vector<uint8_t> Scratch;
+    for (size_t i = begin; i < end; i++) {
+      uint64_t off = (uint64_t)i * PageSize;
+      std::span<const uint8_t> Page =
+          Read(off, (size_t)std::min<uint64_t>(PageSize, Size - off), Scratch);
+      Pages[i] = hash64(Page.data(), Page.size(), i);
+    }
+  };
+
+  // below a few hundred pages a thread costs more than it saves
+  size_t nthreads = std::min<size_t>(
+      std::max(1U, std::thread::hardware_concurrency()), npages / 256 + 1);
+  std::vector<std::thread> Threads;
+  size_t per = (npages + nthreads - 1) / nthreads;
+  for (size_t t = 1; t < nthreads; t++)
+    Threads.emplace_back(Work, std::min(t * per, npages),
+                         std::min((t + 1) * per, npages));
+  Work(0, std::min(per, npages));
+  for (std::thread &T : Threads)
+    T.join();
+
+  std::array<uint8_t, 16> Digest;
+  uint64_t h[2] = {hash64(Pages.data(), Pages.size() * 8, Size),
+                   hash64(Pages.data(), Pages.size() * 8, ~(uint64_t)Size)};
+  std::memcpy(Digest.data(), h, sizeof(h));
+  return Digest;
+}
+
+} // namespace machostrip
@@ -0,0 +1,40 @@
+//
+//  Hash.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace machostrip {
+
+// XXH64 of Size bytes at Data. fast enough to hash every input before it is
+// parsed, but not a cryptographic hash
+uint64_t hash64(const void *Data, size_t Size, uint64_t Seed = 0);
+
+// 128 bit digest of Size bytes at Data. every PageSize bytes are hashed on
+// their own, spread over several threads, and the page hashes are hashed
+// again, so the digest doesn't depend on the number of threads
+std::array<uint8_t, 16> hash_pages(const uint8_t *Data, size_t Size,
+                                   size_t PageSize);
+
+// returns the Size bytes at Offset of an image that isn't contiguous in
+// memory, gathered into Scratch when they have to be
+using PageReader = std::function<std::span<const uint8_t>(
+    uint64_t Offset, size_t Size, std::vector<uint8_t> &Scratch)>;
+
+// hash_pages of the Size bytes Read returns
+std::array<uint8_t, 16> hash_pages(uint64_t Size, size_t PageSize,
+                                   const PageReader &Read);
+
+} // namespace machostrip
+
+#endif
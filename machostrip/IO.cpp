@@ -0,0 +1,309 @@
+//
+//  IO.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "IO.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <sys/clonefile.h>
+#endif
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace machostrip {
+
+MappedFile::~MappedFile() {
+  if (Mapped)
+    ::munmap(const_cast<uint8_t *>(Data), Size);
+  if (Fd >= 0)
+    ::close(Fd);
+}
+
+bool MappedFile::read(int fd) {
+  uint8_t Chunk[1 << 16];
+  for (;;) {
+    ssize_t n = ::read(fd, Chunk, sizeof(Chunk));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return false;
+    if (n == 0)
+      break;
+    Buffer.insert(Buffer.end(), Chunk, Chunk + n);
+  }
+  Data = Buffer.data();
+  Size = Buffer.size();
+  return Size != 0;
+}
+
+bool MappedFile::open(const std::string &Path) {
+  if (Path == "-")
+    return read(STDIN_FILENO);
+
+  int fd = ::open(Path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+  if (!S_ISREG(st.st_mode) || st.st_size <= 0) {
+    bool ok = read(fd);
+    ::close(fd);
+    return ok;
+  }
+  void *P = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (P == MAP_FAILED) {
+    ::close(fd);
+    return false;
+  }
+  // kept open, so the unchanged parts can be copied from the file itself
+  Fd = fd;
+  // the whole file is going to be parsed, start the read-ahead now
+  ::madvise(P, (size_t)st.st_size, MADV_WILLNEED);
+  Data = static_cast<const uint8_t *>(P);
+  Size = (size_t)st.st_size;
+  Mapped = true;
+  return true;
+}
+
+// bytes per gathered write, macOS fails a writev of more than INT_MAX
+static constexpr size_t MaxWrite = 1 << 30;
+
+// write the Count buffers at Iov to Offset, resuming after a short write
+static bool pwritev_all(int fd, iovec *Iov, int Count, uint64_t Offset) {
+  while (Count) {
+#ifdef __APPLE__
+    // pwritev needs macOS 11, the file offset is ours to move
+    ssize_t n = ::lseek(fd, (off_t)Offset, SEEK_SET) < 0
+                    ? -1
+                    : ::writev(fd, Iov, Count);
+#else
+    ssize_t n = ::pwritev(fd, Iov, Count, (off_t)Offset);
+#endif
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    Offset += (uint64_t)n;
+    for (; Count && (size_t)n >= Iov->iov_len; Iov++, Count--)
+      n -= (ssize_t)Iov->iov_len;
+    if (Count) {
+      Iov->iov_base = (uint8_t *)Iov->iov_base + n;
+      Iov->iov_len -= (size_t)n;
+    }
+  }
+  return true;
+}
+
+// copy Size bytes at InOffset of the file In to Offset of fd inside the
+// kernel: a clone sharing the blocks on filesystems that support it, else
+// copy_file_range. return how many bytes were copied, the rest has to be
+// written from user space. macOS has no ranged clone, nothing is copied
+static uint64_t copy_range(int In, uint64_t InOffset, int fd, uint64_t Offset,
+                           uint64_t Size) {
+  uint64_t done = 0;
+#ifdef __linux__
+  if (In < 0)
+    return 0;
+  // fails unless the offsets and the size are block aligned
+  file_clone_range Range{In, InOffset, Size, Offset};
+  if (::ioctl(fd, FICLONERANGE, &Range) == 0)
+    return Size;
+  while (done < Size) {
+    loff_t from = (loff_t)(InOffset + done), to = (loff_t)(Offset + done);
+    size_t n = (size_t)std::min<uint64_t>(Size - done, MaxWrite);
+    ssize_t copied = ::copy_file_range(In, &from, fd, &to, n, 0);
+    if (copied < 0 && errno == EINTR)
+      continue;
+    // EXDEV, ENOSYS or EINVAL on older kernels and special files
+    if (copied <= 0)
+      break;
+    done += (uint64_t)copied;
+  }
+#else
+  (void)In, (void)InOffset, (void)fd, (void)Offset, (void)Size;
+#endif
+  return done;
+}
+
+static void sort_extents(OutputImage &Image) {
+  std::stable_sort(
+      Image.Extents.begin(), Image.Extents.end(),
+      [](const OutputImage::Extent &L, const OutputImage::Extent &R) {
+        return L.Offset < R.Offset;
+      });
+}
+
+static bool write_all(int fd, const uint8_t *Data, size_t Size) {
+  while (Size) {
+    ssize_t n = ::write(fd, Data, Size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    Data += n;
+    Size -= (size_t)n;
+  }
+  return true;
+}
+
+static bool write_zeros(int fd, uint64_t Size) {
+  static const uint8_t Zeros[1 << 12] = {};
+  while (Size) {
+    size_t n = (size_t)std::min<uint64_t>(Size, sizeof(Zeros));
+    if (!write_all(fd, Zeros, n))
+      return false;
+    Size -= n;
+  }
+  return true;
+}
+
+// a pipe can't seek, so the extents go out in order with explicit padding
+static bool stream_image(int fd, OutputImage &Image) {
+  sort_extents(Image);
+  uint64_t off = 0;
+  for (OutputImage::Extent &E : Image.Extents) {
+    std::span<const uint8_t> Bytes = E.bytes();
+    if (E.Offset < off || !write_zeros(fd, E.Offset - off) ||
+        !write_all(fd, Bytes.data(), Bytes.size()))
+      return false;
+    off = E.Offset + Bytes.size();
+    E.Data = {};
+    E.Source.reset();
+  }
+  return off <= Image.Size && write_zeros(fd, Image.Size - off);
+}
+
+bool write_image(const std::string &Path, OutputImage &Image) {
+  if (Path == "-")
+    return stream_image(STDOUT_FILENO, Image);
+
+  // the borrowed extents may point into Path itself, as in stripping a file
+  // in place, so a regular file is never truncated: the image goes to a new
+  // file renamed over it. a link is followed, so the link itself stays
+  std::string Target = Path;
+  struct stat st;
+  if (::lstat(Path.c_str(), &st) == 0 && S_ISLNK(st.st_mode)) {
+    char Resolved[PATH_MAX];
+    if (!::realpath(Path.c_str(), Resolved))
+      return false;
+    Target = Resolved;
+  }
+  bool exists = ::stat(Target.c_str(), &st) == 0;
+  // a device or a fifo can't be mapped as an input, it is written directly
+  std::string Temp =
+      exists && !S_ISREG(st.st_mode) ? std::string() : temp_path(Target);
+  int fd = Temp.empty()
+               ? ::open(Target.c_str(), O_WRONLY | O_TRUNC)
+               : ::open(Temp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+  if (fd < 0)
+    return false;
+  bool ok = true;
+  if (!Temp.empty()) {
+    // a replaced file keeps its permissions. the file is sized first, the
+    // padding between slices is left as a hole
+    ok = (!exists || ::fchmod(fd, st.st_mode & 07777) == 0) &&
+         ::ftruncate(fd, (off_t)Image.Size) == 0;
+  }
+
+  // runs of adjacent extents are gathered into one write
+  sort_extents(Image);
+  std::vector<iovec> Iov;
+  uint64_t begin = 0, end = 0;
+  auto Flush = [&] {
+    bool flushed =
+        Iov.empty() || pwritev_all(fd, Iov.data(), (int)Iov.size(), begin);
+    Iov.clear();
+    return flushed;
+  };
+  for (const OutputImage::Extent &E : Image.Extents) {
+    std::span<const uint8_t> Bytes = E.bytes();
+    size_t off = 0;
+    // the borrowed bytes are still in the input file, unmoved relative to
+    // their slice, which lets the kernel share or copy the blocks
+    if (ok && E.Source && E.Source->fd() >= 0) {
+      ok = Flush();
+      off = (size_t)copy_range(E.Source->fd(),
+                               (uint64_t)(Bytes.data() - E.Source->data()),
+                               fd, E.Offset, Bytes.size());
+    }
+    for (; ok && off < Bytes.size(); off += MaxWrite) {
+      size_t n = std::min(MaxWrite, Bytes.size() - off);
+      if (!Iov.empty() && (E.Offset + off != end || Iov.size() == IOV_MAX ||
+                           end - begin + n > MaxWrite))
+        ok = Flush();
+      if (Iov.empty())
+        begin = end = E.Offset + off;
+      Iov.push_back({const_cast<uint8_t *>(Bytes.data() + off), n});
+      end += n;
+    }
+  }
+  ok = ok && Flush();
+  ok = ::close(fd) == 0 && ok;
+  if (!Temp.empty()) {
+    ok = ok && ::rename(Temp.c_str(), Target.c_str()) == 0;
+    if (!ok)
+      ::unlink(Temp.c_str());
+  }
+  return ok;
+}
+
+std::string temp_path(const std::string &Path) {
+  static std::atomic<unsigned> Counter;
+  return Path + ".tmp" + std::to_string(::getpid()) + "." +
+         std::to_string(Counter++);
+}
+
+// write the whole file From to fd
+static bool copy_to(const std::string &From, int fd) {
+  MappedFile File;
+  return File.open(From) && write_all(fd, File.data(), File.size());
+}
+
+bool copy_file(const std::string &From, const std::string &To, bool Link) {
+  if (To == "-")
+    return copy_to(From, STDOUT_FILENO);
+
+  std::string Temp = temp_path(To);
+  bool ok = false;
+#ifdef __APPLE__
+  // shares the blocks until either file is modified
+  ok = ::clonefile(From.c_str(), Temp.c_str(), 0) == 0;
+#endif
+  if (!ok && Link)
+    ok = ::link(From.c_str(), Temp.c_str()) == 0;
+  if (!ok) {
+    int fd = ::open(Temp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd < 0)
+      return false;
+    MappedFile File;
+    ok = File.open(From);
+    // copy_range leaves the file offset alone
+    uint64_t done = ok ? copy_range(File.fd(), 0, fd, 0, File.size()) : 0;
+    ok = ok && ::lseek(fd, (off_t)done, SEEK_SET) >= 0 &&
+         write_all(fd, File.data() + done, File.size() - done);
+    ok = ::close(fd) == 0 && ok;
+  }
+  // rename is a no-op when To already links to the same file, so the
+  // temporary name is removed either way
+  ok = ok && ::rename(Temp.c_str(), To.c_str()) == 0;
+  ::unlink(Temp.c_str());
+  return ok;
+}
+
+} // namespace machostrip
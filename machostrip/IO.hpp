@@ -0,0 +1,87 @@
+//
+//  IO.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef IO_HPP
+#define IO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace machostrip {
+
+// read-only mapping of a whole input file. "-" and anything that can't be
+// mapped, like a pipe, is read into memory instead
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // map the file at Path and ask the kernel to start reading it in
+  bool open(const std::string &Path);
+
+  const uint8_t *data() const { return Data; }
+  size_t size() const { return Size; }
+  // the open file behind the mapping, -1 when the input was read
+  int fd() const { return Fd; }
+
+private:
+  bool read(int fd);
+
+  const uint8_t *Data = nullptr;
+  size_t Size = 0;
+  bool Mapped = false;
+  int Fd = -1;
+  std::vector<uint8_t> Buffer;
+};
+
+// an output file assembled from byte extents placed at fixed offsets, the
+// gaps between extents read as zero
+struct OutputImage {
+  struct Extent {
+    uint64_t Offset = 0;
+    std::vector<uint8_t> Data;
+    // bytes of an input written as they are instead of Data, Source keeps
+    // them mapped
+    std::span<const uint8_t> Borrowed;
+    std::shared_ptr<const MappedFile> Source;
+
+    std::span<const uint8_t> bytes() const {
+      return Source ? Borrowed : std::span<const uint8_t>(Data);
+    }
+  };
+
+  uint64_t Size = 0;
+  std::vector<Extent> Extents;
+};
+
+// write the extents of Image to a new file renamed over Path, so Path may be
+// the input the extents borrow from. they go in file order, adjacent ones
+// with a single gathered write. borrowed bytes are cloned or copied by the
+// kernel from the input file where it can, else they go straight from the
+// input mapping to the file. "-" streams the image to stdout, releasing each
+// extent once it has been written
+bool write_image(const std::string &Path, OutputImage &Image);
+
+// a fresh name next to Path for a file that is renamed over Path once it is
+// complete
+std::string temp_path(const std::string &Path);
+
+// replace To with the content of the regular file From: a clone where the
+// filesystem supports it, else a hard link if Link is set, else a copy, made
+// by the kernel where it can. the new file appears under To atomically. "-"
+// streams From to stdout
+bool copy_file(const std::string &From, const std::string &To, bool Link);
+
+} // namespace machostrip
+
+#endif
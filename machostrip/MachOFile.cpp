@@ -0,0 +1,376 @@
+//
+//  MachOFile.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "MachOFile.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <mach-o/fat.h>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+
+namespace machostrip {
+
+static uint32_t swap32(uint32_t Value) { return __builtin_bswap32(Value); }
+static uint64_t swap64(uint64_t Value) { return __builtin_bswap64(Value); }
+
+std::vector<Slice> get_slices(const uint8_t *Data, size_t Size) {
+  std::vector<Slice> Slices;
+  if (Size < sizeof(uint32_t))
+    return Slices;
+
+  uint32_t magic = read<uint32_t>(Data);
+  if (magic == MH_MAGIC || magic == MH_MAGIC_64) {
+    Slices.push_back({0, Size});
+    return Slices;
+  }
+  if (magic != FAT_CIGAM && magic != FAT_CIGAM_64)
+    return Slices;
+  if (Size < sizeof(fat_header))
+    return Slices;
+
+  // fat headers are always big endian
+  bool is64 = magic == FAT_CIGAM_64;
+  uint32_t nfat = swap32(read<fat_header>(Data).nfat_arch);
+  size_t archsize = is64 ? sizeof(fat_arch_64) : sizeof(fat_arch);
+  if (sizeof(fat_header) + (uint64_t)nfat * archsize > Size)
+    return Slices;
+
+  for (uint32_t i = 0; i < nfat; i++) {
+    const uint8_t *P = Data + sizeof(fat_header) + i * archsize;
+    Slice S;
+    if (is64) {
+      fat_arch_64 Arch = read<fat_arch_64>(P);
+      S = {swap64(Arch.offset), swap64(Arch.size),
+           (int32_t)swap32((uint32_t)Arch.cputype),
+           (int32_t)swap32((uint32_t)Arch.cpusubtype), swap32(Arch.align)};
+    } else {
+      fat_arch Arch = read<fat_arch>(P);
+      S = {swap32(Arch.offset), swap32(Arch.size),
+           (int32_t)swap32((uint32_t)Arch.cputype),
+           (int32_t)swap32((uint32_t)Arch.cpusubtype), swap32(Arch.align)};
+    }
+    if (S.Offset > Size || S.Size > Size - S.Offset)
+      return {};
+    Slices.push_back(S);
+  }
+  return Slices;
+}
+
+bool is_fat(const uint8_t *Data, size_t Size) {
+  if (Size < sizeof(uint32_t))
+    return false;
+  uint32_t magic = read<uint32_t>(Data);
+  return magic == FAT_CIGAM || magic == FAT_CIGAM_64;
+}
+
+std::vector<uint8_t> make_fat_header(const std::vector<Slice> &Slices,
+                                     bool Use64) {
+  size_t archsize = Use64 ? sizeof(fat_arch_64) : sizeof(fat_arch);
+  std::vector<uint8_t> Header(sizeof(fat_header) + Slices.size() * archsize);
+
+  fat_header FH;
+  FH.magic = swap32(Use64 ? FAT_MAGIC_64 : FAT_MAGIC);
+  FH.nfat_arch = swap32((uint32_t)Slices.size());
+  write(Header.data(), FH);
+  for (size_t i = 0; i < Slices.size(); i++) {
+    const Slice &S = Slices[i];
+    uint8_t *P = Header.data() + sizeof(fat_header) + i * archsize;
+    if (Use64) {
+      fat_arch_64 Arch;
+      Arch.cputype = (cpu_type_t)swap32((uint32_t)S.CpuType);
+      Arch.cpusubtype = (cpu_subtype_t)swap32((uint32_t)S.CpuSubtype);
+      Arch.offset = swap64(S.Offset);
+      Arch.size = swap64(S.Size);
+      Arch.align = swap32(S.Align);
+      Arch.reserved = 0;
+      write(P, Arch);
+    } else {
+      fat_arch Arch;
+      Arch.cputype = (cpu_type_t)swap32((uint32_t)S.CpuType);
+      Arch.cpusubtype = (cpu_subtype_t)swap32((uint32_t)S.CpuSubtype);
+      Arch.offset = swap32((uint32_t)S.Offset);
+      Arch.size = swap32((uint32_t)S.Size);
+      Arch.align = swap32(S.Align);
+      write(P, Arch);
+    }
+  }
+  return Header;
+}
+
+std::vector<Command> get_commands(const uint8_t *Data, size_t Size) {
+  std::vector<Command> Commands;
+  if (Size < sizeof(mach_header))
+    return Commands;
+
+  uint32_t magic = read<uint32_t>(Data);
+  if (magic != MH_MAGIC && magic != MH_MAGIC_64)
+    return Commands;
+  uint64_t off = magic == MH_MAGIC_64 ? sizeof(mach_header_64)
+                                      : sizeof(mach_header);
+  mach_header Header = read<mach_header>(Data);
+  if (off + Header.sizeofcmds > Size)
+    return Commands;
+
+  uint64_t end = off + Header.sizeofcmds;
+  for (uint32_t i = 0; i < Header.ncmds; i++) {
+    if (off + sizeof(load_command) > end)
+      return {};
+    load_command LC = read<load_command>(Data + off);
+    if (LC.cmdsize < sizeof(load_command) || off + LC.cmdsize > end)
+      return {};
+    Commands.push_back({LC.cmd, LC.cmdsize, off});
+    off += LC.cmdsize;
+  }
+  return Commands;
+}
+
+uint64_t commands_end(const uint8_t *Data, size_t Size) {
+  if (Size < sizeof(mach_header_64))
+    return 0;
+  uint32_t magic = read<uint32_t>(Data);
+  if (magic != MH_MAGIC && magic != MH_MAGIC_64)
+    return 0;
+  uint64_t end = (magic == MH_MAGIC_64 ? sizeof(mach_header_64)
+                                       : sizeof(mach_header)) +
+                 read<mach_header>(Data).sizeofcmds;
+  return end <= Size ? end : 0;
+}
+
+std::vector<Segment> get_segments(const uint8_t *Data, size_t Size) {
+  std::vector<Segment> Segments;
+  for (const Command &C : get_commands(Data, Size)) {
+    const uint8_t *P = Data + C.Offset;
+    Segment Seg;
+    if (C.Cmd == LC_SEGMENT_64 && C.Size >= sizeof(segment_command_64)) {
+      segment_command_64 SC = read<segment_command_64>(P);
+      Seg = {std::string(SC.segname, strnlen(SC.segname, 16)),
+             C.Offset,
+             SC.vmaddr,
+             SC.vmsize,
+             SC.fileoff,
+             SC.filesize};
+    } else if (C.Cmd == LC_SEGMENT && C.Size >= sizeof(segment_command)) {
+      segment_command SC = read<segment_command>(P);
+      Seg = {std::string(SC.segname, strnlen(SC.segname, 16)),
+             C.Offset,
+             SC.vmaddr,
+             SC.vmsize,
+             SC.fileoff,
+             SC.filesize};
+    } else {
+      continue;
+    }
+    Segments.push_back(std::move(Seg));
+  }
+  return Segments;
+}
+
+std::vector<RawSection> get_sections(const uint8_t *Data, size_t Size) {
+  std::vector<RawSection> Sections;
+  uint32_t segment = 0;
+  for (const Command &C : get_commands(Data, Size)) {
+    bool is64 = C.Cmd == LC_SEGMENT_64;
+    if (!is64 && C.Cmd != LC_SEGMENT)
+      continue;
+    size_t hdrsize = is64 ? sizeof(segment_command_64)
+                          : sizeof(segment_command);
+    size_t sectsize = is64 ? sizeof(section_64) : sizeof(section);
+    if (C.Size < hdrsize)
+      continue;
+    uint32_t nsects = is64 ? read<segment_command_64>(Data + C.Offset).nsects
+                           : read<segment_command>(Data + C.Offset).nsects;
+    for (uint32_t i = 0; i < nsects; i++) {
+      if (hdrsize + (i + 1) * sectsize > C.Size)
+        break;
+      uint64_t off = C.Offset + hdrsize + i * sectsize;
+      RawSection Sect;
+      Sect.Segment = segment;
+      Sect.HeaderOffset = off;
+      if (is64) {
+        section_64 S = read<section_64>(Data + off);
+        Sect.Name.assign(S.sectname, strnlen(S.sectname, 16));
+        Sect.Segname.assign(S.segname, strnlen(S.segname, 16));
+        Sect.Addr = S.addr;
+        Sect.Size = S.size;
+        Sect.Offset = S.offset;
+        Sect.Flags = S.flags;
+      } else {
+        section S = read<section>(Data + off);
+        Sect.Name.assign(S.sectname, strnlen(S.sectname, 16));
+        Sect.Segname.assign(S.segname, strnlen(S.segname, 16));
+        Sect.Addr = S.addr;
+        Sect.Size = S.size;
+        Sect.Offset = S.offset;
+        Sect.Flags = S.flags;
+      }
+      Sections.push_back(std::move(Sect));
+    }
+    segment++;
+  }
+  return Sections;
+}
+
+std::vector<Blob> get_blobs(const uint8_t *Data, size_t Size,
+                            bool *Dropped) {
+  std::vector<Blob> Blobs;
+  bool dropped = false;
+  auto Add = [&](Blob::Kind K, const Command &C, uint64_t Offset,
+                 uint64_t BlobSize) {
+    if (BlobSize)
+      Blobs.push_back({K, C.Cmd, C.Offset, Offset, BlobSize});
+  };
+
+  for (const Command &C : get_commands(Data, Size)) {
+    const uint8_t *P = Data + C.Offset;
+    switch (C.Cmd) {
+    case LC_SYMTAB: {
+      if (C.Size < sizeof(symtab_command)) {
+        dropped = true;
+        break;
+      }
+      symtab_command SC = read<symtab_command>(P);
+      uint64_t nlistsize = read<uint32_t>(Data) == MH_MAGIC_64
+                               ? sizeof(nlist_64)
+                               : sizeof(struct nlist);
+      Add(Blob::SymbolTable, C, SC.symoff, SC.nsyms * nlistsize);
+      Add(Blob::StringTable, C, SC.stroff, SC.strsize);
+      break;
+    }
+    case LC_DYSYMTAB: {
+      if (C.Size < sizeof(dysymtab_command)) {
+        dropped = true;
+        break;
+      }
+      dysymtab_command DC = read<dysymtab_command>(P);
+      Add(Blob::IndirectSymbols, C, DC.indirectsymoff,
+          DC.nindirectsyms * 4ULL);
+      Add(Blob::ExtRelocs, C, DC.extreloff, DC.nextrel * 8ULL);
+      Add(Blob::LocRelocs, C, DC.locreloff, DC.nlocrel * 8ULL);
+      break;
+    }
+    case LC_DYLD_INFO:
+    case LC_DYLD_INFO_ONLY: {
+      if (C.Size < sizeof(dyld_info_command)) {
+        dropped = true;
+        break;
+      }
+      dyld_info_command DI = read<dyld_info_command>(P);
+      Add(Blob::Rebase, C, DI.rebase_off, DI.rebase_size);
+      Add(Blob::Bind, C, DI.bind_off, DI.bind_size);
+      Add(Blob::WeakBind, C, DI.weak_bind_off, DI.weak_bind_size);
+      Add(Blob::LazyBind, C, DI.lazy_bind_off, DI.lazy_bind_size);
+      Add(Blob::Export, C, DI.export_off, DI.export_size);
+      break;
+    }
+    case LC_CODE_SIGNATURE:
+    case LC_SEGMENT_SPLIT_INFO:
+    case LC_FUNCTION_STARTS:
+    case LC_DATA_IN_CODE:
+    case LC_DYLIB_CODE_SIGN_DRS:
+    case LC_LINKER_OPTIMIZATION_HINT:
+    case LC_DYLD_EXPORTS_TRIE:
+    case LC_DYLD_CHAINED_FIXUPS: {
+      if (C.Size < sizeof(linkedit_data_command)) {
+        dropped = true;
+        break;
+      }
+      linkedit_data_command LD = read<linkedit_data_command>(P);
+      Add(Blob::Data, C, LD.dataoff, LD.datasize);
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  // drop anything that points outside of the slice
+  size_t n = Blobs.size();
+  std::erase_if(Blobs, [&](const Blob &B) {
+    return B.Offset > Size || B.Size > Size - B.Offset;
+  });
+  if (Dropped)
+    *Dropped = dropped || Blobs.size() != n;
+  return Blobs;
+}
+
+uint64_t segment_page_size(uint32_t CpuType) {
+  return CpuType == CPU_TYPE_ARM64 || CpuType == CPU_TYPE_ARM64_32 ||
+                 CpuType == CPU_TYPE_ARM
+             ? 0x4000
+             : 0x1000;
+}
+
+uint8_t *SliceImage::data(uint64_t Offset, uint64_t Size) {
+  if (Offset <= Head.size() && Size <= Head.size() - Offset)
+    return Head.data() + Offset;
+  uint64_t tail = tail_offset();
+  if (Offset >= tail && Offset - tail <= Tail.size() &&
+      Size <= Tail.size() - (Offset - tail))
+    return Tail.data() + (Offset - tail);
+  return nullptr;
+}
+
+std::span<const uint8_t> SliceImage::read(uint64_t Offset, uint64_t Size,
+                                          std::vector<uint8_t> &Scratch) const {
+  if (Offset > size() || Size > size() - Offset)
+    return {};
+  std::span<const uint8_t> Pieces[] = {Head, Borrowed, Tail};
+  uint64_t base = 0;
+  for (std::span<const uint8_t> P : Pieces) {
+    if (Offset >= base && Offset + Size <= base + P.size())
+      return P.subspan(Offset - base, Size);
+    base += P.size();
+  }
+
+  Scratch.resize(Size);
+  base = 0;
+  for (std::span<const uint8_t> P : Pieces) {
+    uint64_t begin = std::max(Offset, base);
+    uint64_t end = std::min(Offset + Size, base + P.size());
+    if (begin < end)
+      std::memcpy(Scratch.data() + (begin - Offset), P.data() + (begin - base),
+                  end - begin);
+    base += P.size();
+  }
+  return Scratch;
+}
+
+void SliceImage::resize(uint64_t Size) {
+  if (Borrowed.empty() && Tail.empty())
+    Head.resize(Size);
+  else
+    Tail.resize(Size - tail_offset());
+}
+
+void update_uuid(SliceImage &Image) {
+  uint8_t *Data = Image.Head.data();
+  uint64_t end = Image.size();
+  uint8_t *UUID = nullptr;
+  for (const Command &C : get_commands(Data, Image.Head.size())) {
+    if (C.Cmd == LC_UUID && C.Size >= sizeof(uuid_command))
+      UUID = Data + C.Offset + offsetof(uuid_command, uuid);
+    if (C.Cmd == LC_CODE_SIGNATURE && C.Size >= sizeof(linkedit_data_command))
+      end = std::min<uint64_t>(
+          end, read<linkedit_data_command>(Data + C.Offset).dataoff);
+  }
+  if (!UUID)
+    return;
+
+  std::memset(UUID, 0, 16);
+  std::array<uint8_t, 16> Digest =
+      hash_pages(end, 0x1000,
+                 [&](uint64_t Offset, size_t Size,
+                     std::vector<uint8_t> &Scratch) {
+                   return Image.read(Offset, Size, Scratch);
+                 });
+  // mark it as a name based uuid, like ld64 does for its md5 uuids
+  Digest[6] = (Digest[6] & 0x0f) | 0x30;
+  Digest[8] = (Digest[8] & 0x3f) | 0x80;
+  std::memcpy(UUID, Digest.data(), 16);
+}
+
+} // namespace machostrip
@@ -0,0 +1,165 @@
+//
+//  MachOFile.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef MACHOFILE_HPP
+#define MACHOFILE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace machostrip {
+
+// a single architecture of a (possibly fat) mach-o image
+struct Slice {
+  uint64_t Offset = 0;
+  uint64_t Size = 0;
+  // fat_arch fields, left to zero for a thin image
+  int32_t CpuType = 0;
+  int32_t CpuSubtype = 0;
+  uint32_t Align = 0;
+};
+
+// whether the raw image starts with a fat header
+bool is_fat(const uint8_t *Data, size_t Size);
+
+// serialize a big endian fat header describing Slices, a 64-bit header is
+// produced when Use64 is set
+std::vector<uint8_t> make_fat_header(const std::vector<Slice> &Slices,
+                                     bool Use64);
+
+// a load command of a thin mach-o, Offset is relative to the slice start
+struct Command {
+  uint32_t Cmd = 0;
+  uint32_t Size = 0;
+  uint64_t Offset = 0;
+};
+
+// a segment load command of a thin mach-o
+struct Segment {
+  std::string Name;
+  uint64_t CmdOffset = 0;
+  uint64_t VMAddr = 0;
+  uint64_t VMSize = 0;
+  uint64_t FileOff = 0;
+  uint64_t FileSize = 0;
+};
+
+// a section header of a thin mach-o. Segment is the index of the segment
+// command that holds it, HeaderOffset where its header starts
+struct RawSection {
+  std::string Name;
+  std::string Segname;
+  uint32_t Segment = 0;
+  uint64_t HeaderOffset = 0;
+  uint64_t Addr = 0;
+  uint64_t Size = 0;
+  uint32_t Offset = 0;
+  uint32_t Flags = 0;
+};
+
+// a range of __LINKEDIT referenced by a load command
+struct Blob {
+  enum Kind {
+    SymbolTable,
+    StringTable,
+    IndirectSymbols,
+    ExtRelocs,
+    LocRelocs,
+    Rebase,
+    Bind,
+    WeakBind,
+    LazyBind,
+    Export,
+    // the payload of a linkedit_data_command, Cmd tells which one
+    Data,
+  };
+
+  Kind K = Data;
+  uint32_t Cmd = 0;
+  uint64_t CmdOffset = 0;
+  uint64_t Offset = 0;
+  uint64_t Size = 0;
+};
+
+// a thin mach-o held in up to three pieces: Head from offset 0, which always
+// holds every load command, then Borrowed, bytes of the input the image was
+// made from that are never modified, then Tail. an image built in one piece
+// only has a Head
+struct SliceImage {
+  std::vector<uint8_t> Head;
+  std::span<const uint8_t> Borrowed;
+  std::vector<uint8_t> Tail;
+
+  uint64_t tail_offset() const { return Head.size() + Borrowed.size(); }
+  uint64_t size() const { return tail_offset() + Tail.size(); }
+
+  // offset of the piece resize grows or shrinks
+  uint64_t end_piece_offset() const {
+    return Borrowed.empty() && Tail.empty() ? 0 : tail_offset();
+  }
+
+  // writable bytes [Offset, Offset + Size), or nullptr when they aren't all
+  // in Head or all in Tail
+  uint8_t *data(uint64_t Offset, uint64_t Size);
+
+  // the bytes [Offset, Offset + Size), gathered into Scratch when they span
+  // more than one piece. nothing when they are out of bounds
+  std::span<const uint8_t> read(uint64_t Offset, uint64_t Size,
+                                std::vector<uint8_t> &Scratch) const;
+
+  // cut or zero extend the image to Size, which can't be less than
+  // end_piece_offset()
+  void resize(uint64_t Size);
+};
+
+template <typename T> inline T read(const uint8_t *P) {
+  T Value;
+  std::memcpy(&Value, P, sizeof(T));
+  return Value;
+}
+
+template <typename T> inline void write(uint8_t *P, const T &Value) {
+  std::memcpy(P, &Value, sizeof(T));
+}
+
+// return the slices of the raw image, a thin mach-o is reported as a single
+// slice covering the whole buffer. malformed images yield no slice
+std::vector<Slice> get_slices(const uint8_t *Data, size_t Size);
+
+// return the load commands of the thin mach-o at Data, or nothing if the
+// header or the command table is out of bounds
+std::vector<Command> get_commands(const uint8_t *Data, size_t Size);
+
+// end of the load command table, i.e. the size of the header plus
+// sizeofcmds. 0 if the header is malformed
+uint64_t commands_end(const uint8_t *Data, size_t Size);
+
+// return the segments of the thin mach-o at Data
+std::vector<Segment> get_segments(const uint8_t *Data, size_t Size);
+
+// return the sections of the thin mach-o at Data, in load command order
+std::vector<RawSection> get_sections(const uint8_t *Data, size_t Size);
+
+// return every non-empty __LINKEDIT range referenced by a load command.
+// Dropped, if given, is set when a command is too small to read or points
+// outside of the slice, as its ranges are missing from the result
+std::vector<Blob> get_blobs(const uint8_t *Data, size_t Size,
+                            bool *Dropped = nullptr);
+
+// page size the segments of cpu type CpuType are aligned to
+uint64_t segment_page_size(uint32_t CpuType);
+
+// replace the LC_UUID of Image with a digest of its content, leaving out
+// the uuid itself and the code signature. the same bytes always get the
+// same uuid
+void update_uuid(SliceImage &Image);
+
+} // namespace machostrip
+
+#endif
@@ -0,0 +1,129 @@
+//
+//  MachOView.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "MachOView.hpp"
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+
+namespace machostrip {
+
+MachOView::MachOView(const uint8_t *Data, size_t Size)
+    : Data(Data), Size(Size) {
+  Commands = get_commands(Data, Size);
+  if (Commands.empty())
+    return;
+  mach_header Header = read<mach_header>(Data);
+  Is64 = Header.magic == MH_MAGIC_64;
+  CpuType = Header.cputype;
+  CpuSubtype = Header.cpusubtype;
+  FileType = Header.filetype;
+  Segments = get_segments(Data, Size);
+  Sections = get_sections(Data, Size);
+  Blobs = get_blobs(Data, Size, &DroppedBlobs);
+}
+
+const Command *MachOView::command(uint32_t Cmd) const {
+  for (const Command &C : Commands)
+    if (C.Cmd == Cmd)
+      return &C;
+  return nullptr;
+}
+
+std::span<const uint8_t> MachOView::blob(Blob::Kind K, uint32_t Cmd) const {
+  for (const Blob &B : Blobs)
+    if (B.K == K && (K != Blob::Data || B.Cmd == Cmd))
+      return {Data + B.Offset, (size_t)B.Size};
+  return {};
+}
+
+std::optional<std::array<uint8_t, 16>> MachOView::uuid() const {
+  const Command *C = command(LC_UUID);
+  if (!C || C->Size < sizeof(uuid_command))
+    return std::nullopt;
+  std::array<uint8_t, 16> UUID;
+  std::memcpy(UUID.data(), read<uuid_command>(Data + C->Offset).uuid, 16);
+  return UUID;
+}
+
+const SymbolTable &MachOView::symbols() const {
+  if (Symbols)
+    return *Symbols;
+
+  std::span<const uint8_t> Table = blob(Blob::SymbolTable);
+  std::span<const uint8_t> Strings = blob(Blob::StringTable);
+  const Command *C = command(LC_DYSYMTAB);
+  if (C && C->Size >= sizeof(dysymtab_command)) {
+    dysymtab_command DC = read<dysymtab_command>(Data + C->Offset);
+    if (DC.ilocalsym == 0 && DC.iextdefsym == DC.nlocalsym &&
+        DC.iundefsym == DC.iextdefsym + DC.nextdefsym) {
+      SymbolTable::Range Ranges{DC.iextdefsym, DC.iundefsym};
+      return Symbols.emplace(Table, Strings, Is64, &Ranges);
+    }
+  }
+  return Symbols.emplace(Table, Strings, Is64);
+}
+
+const std::vector<uint64_t> &MachOView::function_starts() const {
+  if (FunctionStarts)
+    return *FunctionStarts;
+  FunctionStarts.emplace();
+
+  uint64_t address = 0;
+  for (const Segment &Seg : Segments)
+    if (Seg.Name == "__TEXT")
+      address = Seg.VMAddr;
+
+  std::span<const uint8_t> Raw = blob(Blob::Data, LC_FUNCTION_STARTS);
+  const uint8_t *P = Raw.data(), *End = Raw.data() + Raw.size();
+  uint64_t delta;
+  while (P < End && read_uleb(P, End, delta) && delta) {
+    address += delta;
+    FunctionStarts->push_back(address);
+  }
+  return *FunctionStarts;
+}
+
+std::span<const uint8_t> MachOView::export_trie() const {
+  std::span<const uint8_t> Trie = blob(Blob::Data, LC_DYLD_EXPORTS_TRIE);
+  return Trie.empty() ? blob(Blob::Export) : Trie;
+}
+
+const std::vector<RawExport> &MachOView::exports() const {
+  if (!Exports)
+    Exports = parse_export_trie(export_trie(), Storage);
+  return *Exports;
+}
+
+const RawExport *MachOView::find_export(std::string_view Name) const {
+  const std::vector<RawExport> &All = exports();
+  if (!ExportIndex) {
+    ExportIndex.emplace(All.size());
+    for (uint32_t i = 0; i < All.size(); i++)
+      ExportIndex->insert(All[i].Name, i);
+  }
+  const uint32_t *i = ExportIndex->find(Name);
+  return i ? &All[*i] : nullptr;
+}
+
+const std::vector<uint64_t> &MachOView::rebases() const {
+  if (Rebases)
+    return *Rebases;
+  Rebases.emplace();
+  decode_rebases(blob(Blob::Rebase), Segments, Is64, *Rebases);
+  return *Rebases;
+}
+
+const std::vector<uint64_t> &MachOView::bindings() const {
+  if (Bindings)
+    return *Bindings;
+  Bindings.emplace();
+  decode_bindings(blob(Blob::Bind), Segments, Is64, false, *Bindings);
+  decode_bindings(blob(Blob::WeakBind), Segments, Is64, false, *Bindings);
+  decode_bindings(blob(Blob::LazyBind), Segments, Is64, true, *Bindings);
+  return *Bindings;
+}
+
+} // namespace machostrip
@@ -0,0 +1,102 @@
+//
+//  MachOView.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef MACHOVIEW_HPP
+#define MACHOVIEW_HPP
+
+#include "ExportTrie.hpp"
+#include "Fixups.hpp"
+#include "MachOFile.hpp"
+#include "NameIndex.hpp"
+#include "SymbolTable.hpp"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace machostrip {
+
+// read-only view over a thin mach-o. building it only walks the load
+// commands, every LINKEDIT structure stays a raw span until one of its
+// accessors is called for the first time, so a caller interested in the
+// uuid or the string table never pays for decoding symbols or exports
+class MachOView {
+public:
+  MachOView(const uint8_t *Data, size_t Size);
+
+  bool valid() const { return !Commands.empty(); }
+  bool is64() const { return Is64; }
+  int32_t cpu_type() const { return CpuType; }
+  int32_t cpu_subtype() const { return CpuSubtype; }
+  uint32_t file_type() const { return FileType; }
+
+  std::span<const uint8_t> data() const { return {Data, Size}; }
+  const std::vector<Command> &commands() const { return Commands; }
+  const std::vector<Segment> &segments() const { return Segments; }
+  const std::vector<RawSection> &sections() const { return Sections; }
+  const std::vector<Blob> &blobs() const { return Blobs; }
+  // a LINKEDIT reference was malformed or out of range, blobs() misses it
+  bool dropped_blobs() const { return DroppedBlobs; }
+
+  // the first command of type Cmd, if any
+  const Command *command(uint32_t Cmd) const;
+  // the payload of the first blob of kind K (and command Cmd for
+  // Blob::Data), empty if there is none
+  std::span<const uint8_t> blob(Blob::Kind K, uint32_t Cmd = 0) const;
+
+  std::optional<std::array<uint8_t, 16>> uuid() const;
+
+  // decoded on first use
+  const SymbolTable &symbols() const;
+  // the decoded table may be edited, say to drop what a strip removes. the
+  // image itself is never written
+  SymbolTable &symbols() {
+    std::as_const(*this).symbols();
+    return *Symbols;
+  }
+  const std::vector<uint64_t> &function_starts() const;
+  const std::vector<RawExport> &exports() const;
+  // the export named Name, through a hash index built on first use
+  const RawExport *find_export(std::string_view Name) const;
+  // addresses of the LC_DYLD_INFO rebases and of the normal, weak and lazy
+  // bindings, in opcode order
+  const std::vector<uint64_t> &rebases() const;
+  const std::vector<uint64_t> &bindings() const;
+
+  // the raw export trie, from LC_DYLD_EXPORTS_TRIE or LC_DYLD_INFO
+  std::span<const uint8_t> export_trie() const;
+
+private:
+  const uint8_t *Data;
+  size_t Size;
+  bool Is64 = false;
+  int32_t CpuType = 0;
+  int32_t CpuSubtype = 0;
+  uint32_t FileType = 0;
+  std::vector<Command> Commands;
+  std::vector<Segment> Segments;
+  std::vector<RawSection> Sections;
+  std::vector<Blob> Blobs;
+  bool DroppedBlobs = false;
+
+  mutable std::optional<SymbolTable> Symbols;
+  mutable std::optional<std::vector<uint64_t>> FunctionStarts;
+  mutable std::optional<std::vector<RawExport>> Exports;
+  mutable std::optional<NameIndex> ExportIndex;
+  mutable std::optional<std::vector<uint64_t>> Rebases;
+  mutable std::optional<std::vector<uint64_t>> Bindings;
+  // everything decoded that doesn't point into the image, like the export
+  // names, lives as long as the view
+  mutable Arena Storage;
+};
+
+} // namespace machostrip
+
+#endif
@@ -0,0 +1,17 @@
+//
+//  MmapStream.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "MmapStream.hpp"
+
+namespace machostrip {
+
+MmapStream::MmapStream(std::shared_ptr<const MappedFile> File, uint64_t Offset,
+                       uint64_t Size)
+    : LIEF::SpanStream(
+          LIEF::span<const uint8_t>(File->data() + Offset, (size_t)Size)),
+      File(std::move(File)) {}
+
+} // namespace machostrip
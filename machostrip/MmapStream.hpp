@@ -0,0 +1,31 @@
+//
+//  MmapStream.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef MMAPSTREAM_HPP
+#define MMAPSTREAM_HPP
+
+#include "IO.hpp"
+#include "LIEF/BinaryStream/SpanStream.hpp"
+#include <memory>
+
+namespace machostrip {
+
+// LIEF stream over a range of a MappedFile. reads are served straight from
+// the mapping, nothing is copied into a buffer first. it is a SpanStream as
+// far as LIEF is concerned, which keeps every fast path of the parser that
+// checks the stream type, and it keeps the mapping alive while in use
+class MmapStream : public LIEF::SpanStream {
+public:
+  MmapStream(std::shared_ptr<const MappedFile> File, uint64_t Offset,
+             uint64_t Size);
+
+private:
+  std::shared_ptr<const MappedFile> File;
+};
+
+} // namespace machostrip
+
+#endif
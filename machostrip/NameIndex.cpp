@@ -0,0 +1,69 @@
+//
+//  NameIndex.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "NameIndex.hpp"
+#include "Hash.hpp"
+#include <cstring>
+
+namespace machostrip {
+
+NameIndex::NameIndex(size_t Expected) {
+  size_t capacity = 16;
+  while (capacity < Expected * 2)
+    capacity *= 2;
+  Slots.resize(capacity);
+}
+
+uint64_t NameIndex::hash(std::string_view Name) {
+  uint64_t h = hash64(Name.data(), Name.size());
+  return h != Empty ? h : h + 1;
+}
+
+// the slot holding Name, or the empty slot that ends its probe sequence
+size_t NameIndex::lookup(std::string_view Name, uint64_t h) const {
+  size_t mask = Slots.size() - 1;
+  for (size_t i = h & mask;; i = (i + 1) & mask) {
+    const Slot &S = Slots[i];
+    if (S.Hash == Empty)
+      return i;
+    if (S.Hash == h && S.Size == Name.size() &&
+        (Name.empty() || !std::memcmp(S.Name, Name.data(), Name.size())))
+      return i;
+  }
+}
+
+void NameIndex::rehash(size_t Capacity) {
+  std::vector<Slot> Old(Capacity);
+  Old.swap(Slots);
+  size_t mask = Slots.size() - 1;
+  for (const Slot &S : Old) {
+    if (S.Hash == Empty)
+      continue;
+    size_t i = S.Hash & mask;
+    while (Slots[i].Hash != Empty)
+      i = (i + 1) & mask;
+    Slots[i] = S;
+  }
+}
+
+bool NameIndex::insert(std::string_view Name, uint32_t Value) {
+  if ((Count + 1) * 4 > Slots.size() * 3)
+    rehash(Slots.size() * 2);
+  uint64_t h = hash(Name);
+  size_t i = lookup(Name, h);
+  if (Slots[i].Hash != Empty)
+    return false;
+  Slots[i] = {h, Name.data(), (uint32_t)Name.size(), Value};
+  Count++;
+  return true;
+}
+
+const uint32_t *NameIndex::find(std::string_view Name) const {
+  const Slot &S = Slots[lookup(Name, hash(Name))];
+  return S.Hash == Empty ? nullptr : &S.Value;
+}
+
+} // namespace machostrip
@@ -0,0 +1,56 @@
+//
+//  NameIndex.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef NAMEINDEX_HPP
+#define NAMEINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace machostrip {
+
+// open addressing hash table from a name to an index, with linear probing
+// over a power of two slot array. the names are not copied, they have to
+// outlive the index
+class NameIndex {
+public:
+  explicit NameIndex(size_t Expected = 0);
+
+  // add Name, false if it is already present, in which case its value is
+  // left alone
+  bool insert(std::string_view Name, uint32_t Value);
+
+  const uint32_t *find(std::string_view Name) const;
+  bool contains(std::string_view Name) const { return find(Name); }
+
+  size_t size() const { return Count; }
+  bool empty() const { return !Count; }
+
+private:
+  // Hash is Empty for an unused slot, every real hash is moved out of the
+  // way
+  static constexpr uint64_t Empty = 0;
+
+  struct Slot {
+    uint64_t Hash = Empty;
+    const char *Name = nullptr;
+    uint32_t Size = 0;
+    uint32_t Value = 0;
+  };
+
+  static uint64_t hash(std::string_view Name);
+  size_t lookup(std::string_view Name, uint64_t h) const;
+  void rehash(size_t Capacity);
+
+  std::vector<Slot> Slots;
+  size_t Count = 0;
+};
+
+} // namespace machostrip
+
+#endif
@@ -0,0 +1,455 @@
+//
+//  Patch.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "Patch.hpp"
+#include "CodeSign.hpp"
+#include "ExportTrie.hpp"
+#include "MachOView.hpp"
+#include "StringPool.hpp"
+#include "SymbolTable.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+
+namespace machostrip {
+
+namespace {
+
+// new content of a LINKEDIT blob
+struct Rewrite {
+  Blob Old;
+  std::vector<uint8_t> Data;
+  uint64_t Offset = 0;
+};
+
+// a LINKEDIT blob that is moved as it is
+struct Placement {
+  Blob Old;
+  uint64_t Size = 0;
+  uint64_t Offset = 0;
+};
+
+} // namespace
+
+static uint64_t align_up(uint64_t Value, uint64_t Align) {
+  return (Value + Align - 1) & ~(Align - 1);
+}
+
+// point the load command of B in the load commands at Out to Offset. the
+// size is set as well where the command gives it in bytes, counts of
+// entries are left alone
+static void move_blob(uint8_t *Out, const Blob &B, uint64_t Offset,
+                      uint64_t Size) {
+  uint8_t *P = Out + B.CmdOffset;
+  uint32_t offset = (uint32_t)Offset, size = (uint32_t)Size;
+  switch (B.K) {
+  case Blob::SymbolTable:
+  case Blob::StringTable: {
+    symtab_command SC = read<symtab_command>(P);
+    if (B.K == Blob::SymbolTable) {
+      SC.symoff = offset;
+    } else {
+      SC.stroff = offset;
+      SC.strsize = size;
+    }
+    write(P, SC);
+    break;
+  }
+  case Blob::IndirectSymbols:
+  case Blob::ExtRelocs:
+  case Blob::LocRelocs: {
+    dysymtab_command DC = read<dysymtab_command>(P);
+    if (B.K == Blob::IndirectSymbols)
+      DC.indirectsymoff = offset;
+    else if (B.K == Blob::ExtRelocs)
+      DC.extreloff = offset;
+    else
+      DC.locreloff = offset;
+    write(P, DC);
+    break;
+  }
+  case Blob::Rebase:
+  case Blob::Bind:
+  case Blob::WeakBind:
+  case Blob::LazyBind:
+  case Blob::Export: {
+    dyld_info_command DI = read<dyld_info_command>(P);
+    auto Set = [&](uint32_t &Off, uint32_t &Len) {
+      Off = offset;
+      Len = size;
+    };
+    if (B.K == Blob::Rebase)
+      Set(DI.rebase_off, DI.rebase_size);
+    else if (B.K == Blob::Bind)
+      Set(DI.bind_off, DI.bind_size);
+    else if (B.K == Blob::WeakBind)
+      Set(DI.weak_bind_off, DI.weak_bind_size);
+    else if (B.K == Blob::LazyBind)
+      Set(DI.lazy_bind_off, DI.lazy_bind_size);
+    else
+      Set(DI.export_off, DI.export_size);
+    write(P, DI);
+    break;
+  }
+  case Blob::Data: {
+    linkedit_data_command LD = read<linkedit_data_command>(P);
+    LD.dataoff = offset;
+    LD.datasize = size;
+    write(P, LD);
+    break;
+  }
+  }
+}
+
+// true for the load commands known to hold no __LINKEDIT offset besides the
+// ones get_blobs lists. anything else, like LC_TWOLEVEL_HINTS or a command
+// newer than this list, could reference data compaction moves
+static bool is_known_command(uint32_t Cmd) {
+  switch (Cmd) {
+  case LC_SEGMENT:
+  case LC_SEGMENT_64:
+  case LC_SYMTAB:
+  case LC_DYSYMTAB:
+  case LC_DYLD_INFO:
+  case LC_DYLD_INFO_ONLY:
+  case LC_CODE_SIGNATURE:
+  case LC_SEGMENT_SPLIT_INFO:
+  case LC_FUNCTION_STARTS:
+  case LC_DATA_IN_CODE:
+  case LC_DYLIB_CODE_SIGN_DRS:
+  case LC_LINKER_OPTIMIZATION_HINT:
+  case LC_DYLD_EXPORTS_TRIE:
+  case LC_DYLD_CHAINED_FIXUPS:
+  case LC_LOAD_DYLINKER:
+  case LC_ID_DYLINKER:
+  case LC_DYLD_ENVIRONMENT:
+  case LC_UUID:
+  case LC_LOAD_DYLIB:
+  case LC_LOAD_WEAK_DYLIB:
+  case LC_REEXPORT_DYLIB:
+  case LC_LAZY_LOAD_DYLIB:
+  case LC_LOAD_UPWARD_DYLIB:
+  case LC_ID_DYLIB:
+  case LC_PREBOUND_DYLIB:
+  case LC_PREBIND_CKSUM:
+  case LC_RPATH:
+  case LC_MAIN:
+  case LC_UNIXTHREAD:
+  case LC_THREAD:
+  case LC_ROUTINES:
+  case LC_ROUTINES_64:
+  case LC_VERSION_MIN_MACOSX:
+  case LC_VERSION_MIN_IPHONEOS:
+  case LC_VERSION_MIN_TVOS:
+  case LC_VERSION_MIN_WATCHOS:
+  case LC_BUILD_VERSION:
+  case LC_SOURCE_VERSION:
+  case LC_ENCRYPTION_INFO:
+  case LC_ENCRYPTION_INFO_64:
+  case LC_SUB_FRAMEWORK:
+  case LC_SUB_UMBRELLA:
+  case LC_SUB_CLIENT:
+  case LC_SUB_LIBRARY:
+  case LC_LINKER_OPTION:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// rename the sections of the strip rule in the load commands at Out
+static void rename_sections(uint8_t *Out, const MachOView &View) {
+  for (const RawSection &Sect : View.sections()) {
+    // sectname is the first field of both section layouts
+    if (is_renamed_section(View.segments()[Sect.Segment].Name, Sect.Name))
+      std::memcpy(Out + Sect.HeaderOffset, ObfuscatedSectionName, 16);
+  }
+}
+
+bool patch_slice(const uint8_t *Data, size_t Size, const StripOptions &Options,
+                 SliceImage &Output, std::string &Error) {
+  MachOView View(Data, Size);
+  if (!View.valid()) {
+    Error = "malformed load commands";
+    return false;
+  }
+  if (View.file_type() == MH_OBJECT) {
+    Error = "object files have no __LINKEDIT";
+    return false;
+  }
+  // __LINKEDIT is compacted, so every offset into it has to be known
+  for (const Command &C : View.commands()) {
+    if (!is_known_command(C.Cmd)) {
+      char Name[32];
+      snprintf(Name, sizeof(Name), "0x%x", C.Cmd);
+      Error = std::string("unknown load command ") + Name;
+      return false;
+    }
+  }
+  if (View.dropped_blobs()) {
+    Error = "malformed LINKEDIT data reference";
+    return false;
+  }
+
+  // every blob has to live in __LINKEDIT and __LINKEDIT has to come last,
+  // otherwise growing it would move other segments
+  auto Linkedit = std::find_if(
+      View.segments().begin(), View.segments().end(),
+      [](const Segment &Seg) { return Seg.Name == "__LINKEDIT"; });
+  if (Linkedit == View.segments().end()) {
+    Error = "no __LINKEDIT segment";
+    return false;
+  }
+  uint64_t linkbegin = Linkedit->FileOff;
+  uint64_t linkend = Linkedit->FileOff + Linkedit->FileSize;
+  if (linkend > Size) {
+    Error = "__LINKEDIT is truncated";
+    return false;
+  }
+  uint64_t cmdend = commands_end(Data, Size);
+  if (cmdend > linkbegin) {
+    Error = "load commands overlap __LINKEDIT";
+    return false;
+  }
+  for (const Segment &Seg : View.segments()) {
+    if (&Seg != &*Linkedit && Seg.FileSize &&
+        Seg.FileOff + Seg.FileSize > linkbegin) {
+      Error = "__LINKEDIT is not the last segment";
+      return false;
+    }
+  }
+  for (const Blob &B : View.blobs()) {
+    if (B.Offset < linkbegin || B.Offset + B.Size > linkend) {
+      Error = "LINKEDIT data outside of __LINKEDIT";
+      return false;
+    }
+  }
+
+  std::span<const uint8_t> Trie = View.export_trie();
+  if (Trie.empty()) {
+    Error = "no export trie";
+    return false;
+  }
+
+  std::vector<Rewrite> Rewrites;
+  auto OldBlob = [&](Blob::Kind K, uint32_t Cmd = 0) -> const Blob * {
+    for (const Blob &B : View.blobs())
+      if (B.K == K && (K != Blob::Data || B.Cmd == Cmd))
+        return &B;
+    return nullptr;
+  };
+
+  // everything is sized before the output is allocated, so it is allocated
+  // once and never moves. every blob is built into its own buffer and only
+  // placed once all of them are done. the export trie is built on a second
+  // thread: alongside the symbol removal, or when stripped externals are
+  // unexported, decoded there and encoded alongside the string table
+  SymbolTable &Symbols = View.symbols();
+  SymbolRemoval Removal;
+  auto Survives = [&](uint32_t i) {
+    return Removal.Remap.empty() ||
+           Removal.Remap[Symbols.file_index(i)] != ~0U;
+  };
+  std::vector<RawExport> Exports;
+  std::vector<uint8_t> NewTrie;
+  auto EncodeTrie = [&] {
+    if (Options.StripExt) {
+      // a removed external symbol is no longer exported either, its export
+      // is found through the view's name index
+      std::vector<bool> Dropped(Exports.size());
+      SymbolTable::Range R = Symbols.range(SymbolKind::External);
+      for (uint32_t i = R.Begin; i < R.End; i++)
+        if (!Survives(i))
+          if (const RawExport *E = View.find_export(Symbols.name(i)))
+            Dropped[E - View.exports().data()] = true;
+      size_t n = 0;
+      for (size_t i = 0; i < Exports.size(); i++)
+        if (!Dropped[i])
+          Exports[n++] = std::move(Exports[i]);
+      Exports.resize(n);
+    }
+    Exports.push_back({HopperExport, 0, 0, 0, {}});
+    NewTrie = encode_export_trie(Exports);
+  };
+  // the view decodes the exports into its own storage, which nothing else
+  // touches until the task is done. the names stay in the view. the future
+  // waits for the task on every way out, get() rethrows what it threw
+  std::future<void> TrieTask = std::async(std::launch::async, [&] {
+    Exports = View.exports();
+    if (!Options.StripExt)
+      EncodeTrie();
+  });
+
+  // remove local and external symbols, the symbol table only shrinks so it
+  // is compacted in place once the output exists. a successful plan means
+  // the table is partitioned like LC_DYSYMTAB, in file order
+  auto Remove = [&](uint32_t Index, SymbolKind K) {
+    return is_stripped_symbol(
+        K, Index < Symbols.size() ? Symbols.name(Index) : "", Options);
+  };
+  bool planned = plan_symbol_removal(Data, Size, Remove, Removal, Error);
+  TrieTask.get();
+  if (!planned)
+    return false;
+  // without a keep list every local symbol goes, then the passes below
+  // don't need to look at them one by one
+  if (!Removal.Remap.empty() && !Removal.Locals)
+    Symbols.erase(SymbolKind::Local);
+  if (Options.StripExt)
+    TrieTask = std::async(std::launch::async, EncodeTrie);
+
+  // the string table only keeps the names of the symbols that are left,
+  // each stored once
+  uint64_t align = View.is64() ? 8 : 4;
+  const Blob *StringBlob = OldBlob(Blob::StringTable);
+  StringPool Pool;
+  if (StringBlob) {
+    std::vector<std::string_view> Names;
+    for (uint32_t i = 0; i < Symbols.size(); i++)
+      if (Survives(i))
+        Names.push_back(Symbols.name(i));
+    Pool = build_string_pool(Names, align);
+  }
+  if (Options.StripExt)
+    TrieTask.get();
+
+  // remove function starts
+  if (const Blob *B = OldBlob(Blob::Data, LC_FUNCTION_STARTS))
+    Rewrites.push_back({*B, {}});
+
+  const Blob *TrieBlob = OldBlob(Blob::Data, LC_DYLD_EXPORTS_TRIE);
+  if (!TrieBlob)
+    TrieBlob = OldBlob(Blob::Export);
+  Rewrites.push_back({*TrieBlob, std::move(NewTrie)});
+
+  std::vector<uint32_t> Strx = std::move(Pool.Offsets);
+  if (StringBlob)
+    Rewrites.push_back({*StringBlob, std::move(Pool.Data)});
+
+  // the code signature has to stay last
+  const Blob *Signature = OldBlob(Blob::Data, LC_CODE_SIGNATURE);
+  if (Signature) {
+    const uint8_t *Sig = Data + Signature->Offset;
+    Rewrites.push_back({*Signature, {Sig, Sig + Signature->Size}});
+  }
+
+  // __LINKEDIT is compacted: every other blob keeps its order and is packed
+  // from the start of the segment, dropping whatever the strip left unused,
+  // then the rewritten ones follow
+  std::vector<Placement> Moves;
+  size_t entsize = View.is64() ? sizeof(nlist_64) : sizeof(struct nlist);
+  for (const Blob &B : View.blobs()) {
+    if (std::any_of(Rewrites.begin(), Rewrites.end(), [&](const Rewrite &R) {
+          return R.Old.CmdOffset == B.CmdOffset && R.Old.K == B.K;
+        }))
+      continue;
+    uint64_t size = B.Size;
+    if (B.K == Blob::SymbolTable && !Removal.Remap.empty())
+      size = Removal.Kept * entsize;
+    Moves.push_back({B, size});
+  }
+  std::sort(Moves.begin(), Moves.end(),
+            [](const Placement &L, const Placement &R) {
+              return L.Old.Offset < R.Old.Offset;
+            });
+  uint64_t end = linkbegin;
+  for (size_t i = 0; i < Moves.size(); i++) {
+    const Blob &Old = Moves[i].Old;
+    if (i && Old.Offset < Moves[i - 1].Old.Offset + Moves[i - 1].Old.Size) {
+      Error = "overlapping LINKEDIT data";
+      return false;
+    }
+    // never aligned past the old offset, so the blobs can be moved down in
+    // order within the same buffer
+    uint64_t oldalign = Old.Offset & (~Old.Offset + 1);
+    Moves[i].Offset = align_up(end, std::min(align, oldalign));
+    end = Moves[i].Offset + Moves[i].Size;
+  }
+  for (Rewrite &R : Rewrites) {
+    R.Offset = align_up(end, R.Old.Cmd == LC_CODE_SIGNATURE ? 16 : align);
+    end = R.Offset + R.Data.size();
+  }
+  uint64_t newlinkend = end;
+
+  // strip_slice replaces the signature with one sized for the new layout,
+  // leave room for it
+  uint64_t capacity = std::max(linkend, newlinkend);
+  if (Options.Sign && Signature) {
+    uint64_t sigoff = Rewrites.back().Offset;
+    capacity = std::max(capacity,
+                        sigoff + adhoc_signature_size(Data, Size, sigoff));
+  }
+
+  // the segments between the load commands and __LINKEDIT are left as they
+  // are, so they are borrowed instead of copied. the head ends on a page
+  // boundary so that hardly any page hash has to gather two pieces
+  uint64_t headend = std::min(linkbegin, align_up(cmdend, 0x4000));
+  Output = SliceImage();
+  Output.Head.assign(Data, Data + headend);
+  Output.Borrowed = {Data + headend, linkbegin - headend};
+  Output.Tail.reserve(capacity - linkbegin);
+  Output.Tail.assign(Data + linkbegin, Data + linkend);
+  // the symbols are removed at their old place, before anything moves
+  apply_symbol_removal(Output, Removal);
+  uint8_t *Link = Output.Tail.data() - linkbegin;
+  uint64_t packed = linkbegin;
+  for (const Placement &M : Moves) {
+    std::fill(Link + packed, Link + M.Offset, 0);
+    std::memmove(Link + M.Offset, Link + M.Old.Offset, M.Size);
+    packed = M.Offset + M.Size;
+  }
+  // cut off the stale bytes, then zero extend for the rewritten blobs
+  Output.resize(packed);
+  Output.resize(newlinkend);
+  for (const Rewrite &R : Rewrites)
+    std::copy(R.Data.begin(), R.Data.end(),
+              Output.data(R.Offset, R.Data.size()));
+  for (const Placement &M : Moves) {
+    if (M.Old.K != Blob::SymbolTable || Strx.empty())
+      continue;
+    // n_strx is the first field of both nlist layouts, a symbol without a
+    // name keeps 0
+    uint8_t *Table = Output.data(M.Offset, M.Size);
+    for (uint32_t i = 0, k = 0; i < Symbols.size(); i++) {
+      if (!Survives(i))
+        continue;
+      write<uint32_t>(Table + k * entsize, Symbols.strx(i) ? Strx[k] : 0);
+      k++;
+    }
+  }
+
+  // patch the load commands
+  uint8_t *Out = Output.Head.data();
+  rename_sections(Out, View);
+  for (const Placement &M : Moves)
+    move_blob(Out, M.Old, M.Offset, M.Size);
+  for (const Rewrite &R : Rewrites)
+    move_blob(Out, R.Old, R.Offset, R.Data.size());
+
+  if (newlinkend != linkend) {
+    uint64_t page = segment_page_size(View.cpu_type());
+    uint64_t filesize = newlinkend - linkbegin;
+    uint64_t vmsize = align_up(filesize, page);
+    uint8_t *P = Out + Linkedit->CmdOffset;
+    if (View.is64()) {
+      segment_command_64 Seg = read<segment_command_64>(P);
+      Seg.filesize = filesize;
+      Seg.vmsize = vmsize;
+      write(P, Seg);
+    } else {
+      segment_command Seg = read<segment_command>(P);
+      Seg.filesize = (uint32_t)filesize;
+      Seg.vmsize = (uint32_t)vmsize;
+      write(P, Seg);
+    }
+  }
+  return true;
+}
+
+} // namespace machostrip
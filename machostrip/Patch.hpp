@@ -0,0 +1,31 @@
+//
+//  Patch.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef PATCH_HPP
+#define PATCH_HPP
+
+#include "MachOFile.hpp"
+#include "Strip.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace machostrip {
+
+// strip a thin slice without rebuilding it. the load commands are patched in
+// place, the LINKEDIT blobs the strip passes change are rewritten and the
+// segments in between are borrowed from Data, which has to outlive Output.
+// __LINKEDIT is compacted: the untouched blobs are packed in their old order,
+// followed by the rewritten ones and the code signature, and the segment
+// shrinks to fit. the string table is rebuilt from the names of the symbols
+// that are left. returns false, with the reason in Error, when the slice
+// needs the full LIEF rebuild instead
+bool patch_slice(const uint8_t *Data, size_t Size, const StripOptions &Options,
+                 SliceImage &Output, std::string &Error);
+
+} // namespace machostrip
+
+#endif
@@ -0,0 +1,71 @@
+//
+//  Scramble.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "Scramble.hpp"
+#include "MachOFile.hpp"
+#include <mach-o/loader.h>
+
+namespace machostrip {
+
+// lowbias32 by Chris Wellons, a cheap 32-bit integer hash
+static inline uint32_t mix(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352dU;
+  x ^= x >> 15;
+  x *= 0x846ca68bU;
+  x ^= x >> 16;
+  return x;
+}
+
+Scrambler::Scrambler(uint64_t Seed, FillMode Mode) : Mode(Mode) {
+  Key[0] = mix((uint32_t)Seed ^ 0x9e3779b9U);
+  Key[1] = mix((uint32_t)(Seed >> 32) ^ Key[0]);
+}
+
+void Scrambler::next_block(uint8_t *Block) {
+  uint32_t Words[Lanes];
+  uint32_t lo = (uint32_t)Counter, hi = (uint32_t)(Counter >> 32);
+  for (size_t i = 0; i < Lanes; i++)
+    Words[i] = mix(mix((lo + (uint32_t)i) ^ Key[0]) + (hi ^ Key[1]));
+  Counter += Lanes;
+
+  std::memcpy(Block, Words, BlockSize);
+  for (size_t i = 0; i < BlockSize; i++)
+    Block[i] = Block[i] ? Block[i] : 0xff;
+}
+
+void Scrambler::fill(uint8_t *Data, size_t Size) {
+  alignas(16) uint8_t Block[BlockSize];
+  if (Mode == FillMode::Pattern)
+    next_block(Block);
+
+  while (Size >= BlockSize) {
+    if (Mode == FillMode::Random)
+      next_block(Block);
+    std::memcpy(Data, Block, BlockSize);
+    Data += BlockSize;
+    Size -= BlockSize;
+  }
+  if (Size) {
+    if (Mode == FillMode::Random)
+      next_block(Block);
+    std::memcpy(Data, Block, Size);
+  }
+}
+
+void scramble_strtabs(SliceImage &Image, Scrambler &S) {
+  for (const Command &C : get_commands(Image.Head.data(), Image.Head.size())) {
+    if (C.Cmd != LC_SYMTAB)
+      continue;
+    symtab_command Symtab =
+        read<symtab_command>(Image.Head.data() + C.Offset);
+    // the string table is in __LINKEDIT, which is never borrowed
+    if (uint8_t *Strings = Image.data(Symtab.stroff, Symtab.strsize))
+      S.fill(Strings, Symtab.strsize);
+  }
+}
+
+} // namespace machostrip
@@ -0,0 +1,49 @@
+//
+//  Scramble.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef SCRAMBLE_HPP
+#define SCRAMBLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace machostrip {
+
+enum class FillMode {
+  // a fresh keystream for every byte
+  Random,
+  // one keystream block repeated, deterministic and cheap to zip
+  Pattern,
+};
+
+// fills byte ranges from a counter based keystream. every 32-bit word is an
+// independent hash of (key, counter), so a block of lanes is computed at once
+// and the loop vectorizes. no byte of the output is ever zero
+class Scrambler {
+public:
+  Scrambler(uint64_t Seed, FillMode Mode);
+
+  void fill(uint8_t *Data, size_t Size);
+
+private:
+  static constexpr size_t Lanes = 16;
+  static constexpr size_t BlockSize = Lanes * sizeof(uint32_t);
+
+  void next_block(uint8_t *Block);
+
+  uint32_t Key[2];
+  uint64_t Counter = 0;
+  FillMode Mode;
+};
+
+struct SliceImage;
+
+// scramble the string table of a thin image
+void scramble_strtabs(SliceImage &Image, Scrambler &S);
+
+} // namespace machostrip
+
+#endif
@@ -0,0 +1,221 @@
+//
+//  Sha256.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "Sha256.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_SHA2)
+#include <arm_neon.h>
+#define SHA256_ARM 1
+#endif
+
+namespace machostrip {
+
+alignas(16) static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static uint32_t rotr(uint32_t X, int R) { return (X >> R) | (X << (32 - R)); }
+
+static void compress_generic(uint32_t State[8], const uint8_t *Data,
+                             size_t Blocks) {
+  for (; Blocks--; Data += 64) {
+    uint32_t W[64];
+    for (int i = 0; i < 16; i++)
+      W[i] = (uint32_t)Data[i * 4] << 24 | (uint32_t)Data[i * 4 + 1] << 16 |
+             (uint32_t)Data[i * 4 + 2] << 8 | Data[i * 4 + 3];
+    for (int i = 16; i < 64; i++) {
+      uint32_t s0 = rotr(W[i - 15], 7) ^ rotr(W[i - 15], 18) ^ (W[i - 15] >> 3);
+      uint32_t s1 = rotr(W[i - 2], 17) ^ rotr(W[i - 2], 19) ^ (W[i - 2] >> 10);
+      W[i] = W[i - 16] + s0 + W[i - 7] + s1;
+    }
+    uint32_t a = State[0], b = State[1], c = State[2], d = State[3];
+    uint32_t e = State[4], f = State[5], g = State[6], h = State[7];
+    for (int i = 0; i < 64; i++) {
+      uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) +
+                    ((e & f) ^ (~e & g)) + K[i] + W[i];
+      uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) +
+                    ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    State[0] += a;
+    State[1] += b;
+    State[2] += c;
+    State[3] += d;
+    State[4] += e;
+    State[5] += f;
+    State[6] += g;
+    State[7] += h;
+  }
+}
+
+#if SHA256_X86
+// four rounds per step, the message schedule is extended with
+// sha256msg1/sha256msg2 while the rounds run
+__attribute__((target("sha,sse4.1"))) static void
+compress_shani(uint32_t State[8], const uint8_t *Data, size_t Blocks) {
+  const __m128i Swap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i Tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)State),
+                                  0xb1);
+  __m128i State1 =
+      _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(State + 4)), 0x1b);
+  __m128i State0 = _mm_alignr_epi8(Tmp, State1, 8); // ABEF
+  State1 = _mm_blend_epi16(State1, Tmp, 0xf0);      // CDGH
+
+  for (; Blocks--; Data += 64) {
+    __m128i SaveAbef = State0, SaveCdgh = State1;
+    __m128i W[4];
+    for (int i = 0; i < 4; i++)
+      W[i] = _mm_shuffle_epi8(
+          _mm_loadu_si128((const __m128i *)(Data + i * 16)), Swap);
+    for (int i = 0; i < 16; i++) {
+      if (i >= 4) {
+        __m128i &Wi = W[i & 3];
+        Wi = _mm_sha256msg1_epu32(Wi, W[(i + 1) & 3]);
+        Wi = _mm_add_epi32(Wi,
+                           _mm_alignr_epi8(W[(i + 3) & 3], W[(i + 2) & 3], 4));
+        Wi = _mm_sha256msg2_epu32(Wi, W[(i + 3) & 3]);
+      }
+      __m128i Msg = _mm_add_epi32(
+          W[i & 3], _mm_load_si128((const __m128i *)(K + i * 4)));
+      State1 = _mm_sha256rnds2_epu32(State1, State0, Msg);
+      State0 = _mm_sha256rnds2_epu32(State0, State1,
+                                     _mm_shuffle_epi32(Msg, 0x0e));
+    }
+    State0 = _mm_add_epi32(State0, SaveAbef);
+    State1 = _mm_add_epi32(State1, SaveCdgh);
+  }
+
+  Tmp = _mm_shuffle_epi32(State0, 0x1b);        // FEBA
+  State1 = _mm_shuffle_epi32(State1, 0xb1);     // DCHG
+  State0 = _mm_blend_epi16(Tmp, State1, 0xf0);  // DCBA
+  State1 = _mm_alignr_epi8(State1, Tmp, 8);     // HGFE
+  _mm_storeu_si128((__m128i *)State, State0);
+  _mm_storeu_si128((__m128i *)(State + 4), State1);
+}
+
+static bool has_shani() {
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+    return false;
+  return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1 << 29));
+}
+#endif
+
+#if SHA256_ARM
+static void compress_armv8(uint32_t State[8], const uint8_t *Data,
+                           size_t Blocks) {
+  uint32x4_t State0 = vld1q_u32(State);
+  uint32x4_t State1 = vld1q_u32(State + 4);
+
+  for (; Blocks--; Data += 64) {
+    uint32x4_t SaveAbcd = State0, SaveEfgh = State1;
+    uint32x4_t W[4];
+    for (int i = 0; i < 4; i++)
+      W[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(Data + i * 16)));
+    for (int i = 0; i < 16; i++) {
+      if (i >= 4)
+        W[i & 3] = vsha256su1q_u32(vsha256su0q_u32(W[i & 3], W[(i + 1) & 3]),
+                                   W[(i + 2) & 3], W[(i + 3) & 3]);
+      uint32x4_t Msg = vaddq_u32(W[i & 3], vld1q_u32(K + i * 4));
+      uint32x4_t Prev = State0;
+      State0 = vsha256hq_u32(State0, State1, Msg);
+      State1 = vsha256h2q_u32(State1, Prev, Msg);
+    }
+    State0 = vaddq_u32(State0, SaveAbcd);
+    State1 = vaddq_u32(State1, SaveEfgh);
+  }
+
+  vst1q_u32(State, State0);
+  vst1q_u32(State + 4, State1);
+}
+#endif
+
+using CompressFn = void (*)(uint32_t *, const uint8_t *, size_t);
+
+static CompressFn select_compress() {
+#if SHA256_X86
+  if (has_shani())
+    return compress_shani;
+#elif SHA256_ARM
+  return compress_armv8;
+#endif
+  return compress_generic;
+}
+
+static const CompressFn Compress = select_compress();
+
+Sha256::Sha256()
+    : State{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f,
+            0x9b05688c, 0x1f83d9ab, 0x5be0cd19} {}
+
+void Sha256::update(const void *Data, size_t Size) {
+  const uint8_t *P = static_cast<const uint8_t *>(Data);
+  Length += Size;
+  if (Buffered) {
+    size_t n = std::min(Size, sizeof(Buffer) - Buffered);
+    std::memcpy(Buffer + Buffered, P, n);
+    Buffered += n;
+    P += n;
+    Size -= n;
+    if (Buffered < sizeof(Buffer))
+      return;
+    Compress(State, Buffer, 1);
+    Buffered = 0;
+  }
+  // whole blocks straight from the input
+  if (Size >= 64) {
+    Compress(State, P, Size / 64);
+    P += Size & ~(size_t)63;
+    Size &= 63;
+  }
+  std::memcpy(Buffer, P, Size);
+  Buffered = Size;
+}
+
+Sha256::Digest Sha256::final() {
+  uint64_t bits = Length * 8;
+  uint8_t Pad[72] = {0x80};
+  size_t padsize = (Buffered < 56 ? 56 : 120) - Buffered;
+  for (int i = 0; i < 8; i++)
+    Pad[padsize + i] = (uint8_t)(bits >> (56 - i * 8));
+  update(Pad, padsize + 8);
+
+  Digest D;
+  for (int i = 0; i < 8; i++)
+    for (int j = 0; j < 4; j++)
+      D[i * 4 + j] = (uint8_t)(State[i] >> (24 - j * 8));
+  return D;
+}
+
+Sha256::Digest Sha256::hash(const void *Data, size_t Size) {
+  Sha256 H;
+  H.update(Data, Size);
+  return H.final();
+}
+
+} // namespace machostrip
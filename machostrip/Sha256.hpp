@@ -0,0 +1,37 @@
+//
+//  Sha256.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace machostrip {
+
+// SHA-256, using the SHA extensions of x86 or ARMv8 when the cpu has them
+class Sha256 {
+public:
+  using Digest = std::array<uint8_t, 32>;
+
+  Sha256();
+
+  void update(const void *Data, size_t Size);
+  Digest final();
+
+  static Digest hash(const void *Data, size_t Size);
+
+private:
+  uint32_t State[8];
+  uint8_t Buffer[64];
+  size_t Buffered = 0;
+  uint64_t Length = 0;
+};
+
+} // namespace machostrip
+
+#endif
@@ -0,0 +1,47 @@
+//
+//  StringPool.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "StringPool.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace machostrip {
+
+StringPool build_string_pool(std::span<const std::string_view> Names,
+                             size_t Align) {
+  // sorted by reversed name, every name comes right before the ones it is a
+  // suffix of, so walking backwards a name is either a suffix of the last
+  // one stored or shares no suffix with anything stored before
+  std::vector<uint32_t> Order(Names.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  std::sort(Order.begin(), Order.end(), [&](uint32_t L, uint32_t R) {
+    return std::lexicographical_compare(Names[L].rbegin(), Names[L].rend(),
+                                        Names[R].rbegin(), Names[R].rend());
+  });
+
+  StringPool Pool;
+  Pool.Offsets.resize(Names.size());
+  // like ld64 the table starts with a space, so no name is at offset 0
+  Pool.Data = {' ', 0};
+  std::string_view Last;
+  uint32_t last = 0;
+  for (auto It = Order.rbegin(); It != Order.rend(); ++It) {
+    std::string_view Name = Names[*It];
+    if (last && Last.ends_with(Name)) {
+      Pool.Offsets[*It] = last + (uint32_t)(Last.size() - Name.size());
+      continue;
+    }
+    last = (uint32_t)Pool.Data.size();
+    Last = Name;
+    Pool.Offsets[*It] = last;
+    Pool.Data.insert(Pool.Data.end(), Name.begin(), Name.end());
+    Pool.Data.push_back(0);
+  }
+  Pool.Data.resize((Pool.Data.size() + Align - 1) / Align * Align);
+  return Pool;
+}
+
+} // namespace machostrip
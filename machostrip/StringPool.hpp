@@ -0,0 +1,33 @@
+//
+//  StringPool.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef STRINGPOOL_HPP
+#define STRINGPOOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace machostrip {
+
+// a mach-o string table. Offsets[i] is where the i-th name it was built from
+// starts
+struct StringPool {
+  std::vector<uint8_t> Data;
+  std::vector<uint32_t> Offsets;
+};
+
+// build the smallest string table holding Names: every name is stored once
+// and a name that is the suffix of another one points into it, so "_foo"
+// shares the bytes of "_bar_foo". the size is padded to a multiple of Align
+StringPool build_string_pool(std::span<const std::string_view> Names,
+                             size_t Align);
+
+} // namespace machostrip
+
+#endif
@@ -0,0 +1,377 @@
+//
+//  Strip.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "Strip.hpp"
+#include "CodeSign.hpp"
+#include "Hash.hpp"
+#include "MachOView.hpp"
+#include "LIEF/LIEF.hpp"
+#include "MachOFile.hpp"
+#include "MmapStream.hpp"
+#include "Patch.hpp"
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <mach-o/fat.h>
+#include <mach-o/loader.h>
+#include <thread>
+
+using namespace LIEF::MachO;
+
+namespace machostrip {
+
+bool read_keep_list(const std::string &Path, KeepList &Keep,
+                    std::string &Error) {
+  std::ifstream file(Path, std::ios::binary);
+  if (!file) {
+    Error = "failed to open " + Path;
+    return false;
+  }
+  Keep.Text.assign(std::istreambuf_iterator<char>(file), {});
+  Keep.Hash = hash64(Keep.Text.data(), Keep.Text.size());
+
+  // the index points into Text, which doesn't change from here on
+  std::string_view Rest = Keep.Text;
+  while (!Rest.empty()) {
+    size_t eol = Rest.find('\n');
+    std::string_view Line = Rest.substr(0, eol);
+    Rest.remove_prefix(eol == std::string_view::npos ? Rest.size() : eol + 1);
+    if (!Line.empty() && Line.back() == '\r')
+      Line.remove_suffix(1);
+    if (Line.empty() || Line[0] == '#')
+      continue;
+    Keep.Names.insert(Line, 0);
+  }
+  return true;
+}
+
+bool is_renamed_section(std::string_view Segname, std::string_view Sectname) {
+  if (Segname != "__TEXT" && Segname != "__DATA" && Segname != "__DATA__CONST")
+    return false;
+  return Sectname.find("__objc") == std::string::npos &&
+         Sectname.find("__swift") == std::string::npos &&
+         Sectname.find("__unwind") == std::string::npos &&
+         Sectname.find("__eh") == std::string::npos &&
+         Sectname.find("__gcc") == std::string::npos &&
+         Sectname.find("__auth") == std::string::npos &&
+         Sectname.find("__got") == std::string::npos;
+}
+
+void strip_binary(
+    Binary &Bin, const StripOptions &Options,
+    const std::function<bool(std::string_view)> &Unexported) {
+  // remove function starts
+  if (FunctionStarts *FS = Bin.function_starts())
+    FS->functions({});
+  // the removed external symbols are no longer exported
+  if (Options.StripExt) {
+    std::vector<std::string> Names;
+    for (Symbol &Sym : Bin.symbols())
+      if (Sym.category() == Symbol::CATEGORY::EXTERNAL &&
+          Sym.has_export_info() &&
+          (Unexported ? Unexported(Sym.name())
+                      : is_stripped_symbol(SymbolKind::External, Sym.name(),
+                                           Options)))
+        Names.push_back(Sym.name());
+    for (const std::string &Name : Names)
+      Bin.unexport(Name);
+  }
+  for (SegmentCommand &Seg : Bin.segments())
+    for (Section &Sec : Seg.sections())
+      if (is_renamed_section(Seg.name(), Sec.name()))
+        Sec.name(ObfuscatedSectionName);
+  Bin.add_exported_function(0, HopperExport);
+}
+
+// remove the symbols through LIEF, one at a time. only used when the built
+// symbol table can't be compacted by remove_symbols
+static void remove_symbols(Binary &Bin, const StripOptions &Options) {
+  std::vector<Symbol *> symtoremove;
+  for (Symbol &Sym : Bin.symbols()) {
+    if ((Sym.category() == Symbol::CATEGORY::LOCAL &&
+         is_stripped_symbol(SymbolKind::Local, Sym.name(), Options)) ||
+        (Sym.category() == Symbol::CATEGORY::EXTERNAL &&
+         is_stripped_symbol(SymbolKind::External, Sym.name(), Options)))
+      symtoremove.emplace_back(&Sym);
+  }
+  for (Symbol *Sym : symtoremove)
+    Bin.remove(*Sym);
+}
+
+// parser configuration for the strip passes. the export trie is decoded
+// since an export is added to it, the rebase and bind opcodes are never
+// edited so the builder copies them through as they are
+static ParserConfig strip_parser_config() {
+  ParserConfig Config = ParserConfig::deep();
+  Config.parse_dyld_bindings = false;
+  Config.parse_dyld_rebases = false;
+  return Config;
+}
+
+// whether Out kept everything of In the strip passes don't touch: the
+// content of every segment past the load commands, and the rebase, bind and
+// chained fixup opcodes
+static bool preserves_payload(const uint8_t *In, size_t InSize,
+                              const uint8_t *Out, size_t OutSize) {
+  uint64_t inend = commands_end(In, InSize);
+  uint64_t outend = commands_end(Out, OutSize);
+  if (!inend || !outend)
+    return false;
+
+  std::vector<Segment> OutSegs = get_segments(Out, OutSize);
+  for (const Segment &Seg : get_segments(In, InSize)) {
+    if (Seg.Name == "__LINKEDIT" || !Seg.FileSize)
+      continue;
+    auto It = std::find_if(OutSegs.begin(), OutSegs.end(),
+                           [&](const Segment &O) {
+                             return O.Name == Seg.Name &&
+                                    O.FileOff == Seg.FileOff &&
+                                    O.FileSize == Seg.FileSize;
+                           });
+    uint64_t begin = std::max({Seg.FileOff, inend, outend});
+    uint64_t end = Seg.FileOff + Seg.FileSize;
+    if (It == OutSegs.end() || end > InSize || end > OutSize)
+      return false;
+    if (begin < end && std::memcmp(In + begin, Out + begin, end - begin))
+      return false;
+  }
+
+  auto IsOpcodes = [](const Blob &B) {
+    return B.K == Blob::Rebase || B.K == Blob::Bind ||
+           B.K == Blob::WeakBind || B.K == Blob::LazyBind ||
+           (B.K == Blob::Data && B.Cmd == LC_DYLD_CHAINED_FIXUPS);
+  };
+  std::vector<Blob> OutBlobs = get_blobs(Out, OutSize);
+  for (const Blob &B : get_blobs(In, InSize)) {
+    if (!IsOpcodes(B))
+      continue;
+    auto It = std::find_if(OutBlobs.begin(), OutBlobs.end(),
+                           [&](const Blob &O) {
+                             return O.K == B.K && O.Cmd == B.Cmd;
+                           });
+    if (It == OutBlobs.end() || It->Size != B.Size ||
+        std::memcmp(In + B.Offset, Out + It->Offset, B.Size))
+      return false;
+  }
+  return true;
+}
+
+// parse the slice with Config, strip it and build it into Output
+static bool build_slice(const std::shared_ptr<const MappedFile> &Input,
+                        const Slice &Sl, const ParserConfig &Config,
+                        std::vector<uint8_t> &Output,
+                        const StripOptions &Options,
+                        const std::function<bool(std::string_view)> &Unexported,
+                        std::string &Error) {
+  std::unique_ptr<FatBinary> Binaries = Parser::parse(
+      std::make_unique<MmapStream>(Input, Sl.Offset, Sl.Size), Config);
+  if (!Binaries || Binaries->size() != 1) {
+    Error = "failed to parse";
+    return false;
+  }
+  Binary &Bin = *Binaries->at(0);
+  strip_binary(Bin, Options, Unexported);
+
+  // build the stripped slice in memory, the string table is obfuscated
+  // before anything is written so every output is written exactly once
+  Output.clear();
+  if (!Builder::write(Bin, Output)) {
+    Error = "failed to rebuild";
+    return false;
+  }
+
+  // dropping the symbols from the built image is a single pass, removing
+  // them from Bin one by one is quadratic
+  MachOView Built(Output.data(), Output.size());
+  const SymbolTable &Symbols = Built.symbols();
+  auto Remove = [&](uint32_t Index, SymbolKind K) {
+    return is_stripped_symbol(
+        K, Index < Symbols.size() ? Symbols.name(Index) : "", Options);
+  };
+  if (remove_symbols(Output.data(), Output.size(), Remove, Error))
+    return true;
+  Error.clear();
+  remove_symbols(Bin, Options);
+  Output.clear();
+  if (!Builder::write(Bin, Output)) {
+    Error = "failed to rebuild";
+    return false;
+  }
+  return true;
+}
+
+// strip a single thin slice with the LIEF builder
+static bool rebuild_slice(const std::shared_ptr<const MappedFile> &Input,
+                          const Slice &Sl, std::vector<uint8_t> &Output,
+                          const StripOptions &Options, std::string &Error) {
+  // only the external symbols remove_symbols drops are unexported, one the
+  // indirect symbol table pins stays in the symbol table and keeps its
+  // export, like it does when patching. if the input can't be planned the
+  // symbols are removed through LIEF, which drops every stripped one
+  const uint8_t *In = Input->data() + Sl.Offset;
+  MachOView View(In, Sl.Size);
+  const SymbolTable &Symbols = View.symbols();
+  SymbolRemoval Plan;
+  std::function<bool(std::string_view)> Unexported;
+  if (Options.StripExt) {
+    auto Remove = [&](uint32_t Index, SymbolKind K) {
+      return is_stripped_symbol(
+          K, Index < Symbols.size() ? Symbols.name(Index) : "", Options);
+    };
+    std::string PlanError;
+    // LIEF hands out names, the plan is by index: the symbol table's name
+    // index leads from one to the other
+    if (plan_symbol_removal(In, Sl.Size, Remove, Plan, PlanError))
+      Unexported = [&](std::string_view Name) {
+        std::optional<uint32_t> i = Symbols.find(Name);
+        return i && !Plan.Remap.empty() &&
+               Symbols.kind(*i) == SymbolKind::External &&
+               Plan.Remap[Symbols.file_index(*i)] == ~0U;
+      };
+  }
+
+  if (Options.DeepParse)
+    return build_slice(Input, Sl, ParserConfig::deep(), Output, Options,
+                       Unexported, Error);
+
+  // the strip profile relies on the builder copying the opcodes it didn't
+  // decode, if anything it shouldn't touch moved, parse everything instead
+  if (build_slice(Input, Sl, strip_parser_config(), Output, Options,
+                  Unexported, Error) &&
+      preserves_payload(In, Sl.Size, Output.data(), Output.size()))
+    return true;
+  Error.clear();
+  return build_slice(Input, Sl, ParserConfig::deep(), Output, Options,
+                     Unexported, Error);
+}
+
+// strip and scramble a single thin slice
+static bool strip_slice(const std::shared_ptr<const MappedFile> &Input,
+                        const Slice &Sl, SliceImage &Output,
+                        const StripOptions &Options, uint64_t Seed,
+                        std::string &Error) {
+  // patching LINKEDIT in place is cheapest, the builder is the fallback for
+  // every slice the patcher doesn't handle
+  bool patched = !Options.Rebuild &&
+                 patch_slice(Input->data() + Sl.Offset, Sl.Size, Options,
+                             Output, Error);
+  if (!patched) {
+    Error.clear();
+    Output = SliceImage();
+    if (!rebuild_slice(Input, Sl, Output.Head, Options, Error))
+      return false;
+  }
+
+  // obfuscate symbol stub name
+  Scrambler S(Seed, Options.Fill);
+  scramble_strtabs(Output, S);
+  update_uuid(Output);
+  if (!Options.Sign)
+    return true;
+
+  // the signature covers the uuid, so it goes last. the patcher only
+  // rewrites the load commands and __LINKEDIT, which starts at the tail, the
+  // pages in between are known to be the same as in the input
+  SignBase Base{{Input->data() + Sl.Offset, Sl.Size}};
+  if (patched) {
+    Base.CleanBegin = commands_end(Output.Head.data(), Output.Head.size());
+    Base.CleanEnd = Output.tail_offset();
+  }
+  return adhoc_sign(Output, &Base, Error);
+}
+
+// add the pieces of Image to Output at Offset. the borrowed bytes stay in
+// Input, which the extent keeps mapped until it is written
+static void add_slice(OutputImage &Output, uint64_t Offset, SliceImage &Image,
+                      const std::shared_ptr<const MappedFile> &Input) {
+  uint64_t borrowed = Offset + Image.Head.size();
+  uint64_t tail = Offset + Image.tail_offset();
+  Output.Extents.push_back({Offset, std::move(Image.Head), {}, {}});
+  if (!Image.Borrowed.empty())
+    Output.Extents.push_back({borrowed, {}, Image.Borrowed, Input});
+  if (!Image.Tail.empty())
+    Output.Extents.push_back({tail, std::move(Image.Tail), {}, {}});
+}
+
+bool strip_image(const std::shared_ptr<const MappedFile> &Input,
+                 OutputImage &Output, const StripOptions &Options,
+                 std::string &Error) {
+  std::vector<Slice> Slices = get_slices(Input->data(), Input->size());
+  if (Slices.empty()) {
+    Error = "not a mach-o file";
+    return false;
+  }
+
+  uint64_t seed = Options.Seed ? *Options.Seed
+                               : hash64(Input->data(), Input->size());
+  std::vector<uint64_t> Seeds;
+  for (size_t i = 0; i < Slices.size(); i++)
+    Seeds.push_back(hash64(&seed, sizeof(seed), i));
+
+  // slices are independent until the fat header is assembled, so each one
+  // is parsed, stripped and built on its own thread
+  std::vector<SliceImage> Built(Slices.size());
+  std::vector<std::string> Errors(Slices.size());
+  auto Work = [&](size_t i) {
+    try {
+      strip_slice(Input, Slices[i], Built[i], Options, Seeds[i], Errors[i]);
+    } catch (const std::exception &E) {
+      Errors[i] = E.what();
+    }
+  };
+  if (Slices.size() == 1) {
+    Work(0);
+  } else {
+    std::vector<std::thread> Threads;
+    for (size_t i = 0; i < Slices.size(); i++)
+      Threads.emplace_back(Work, i);
+    for (std::thread &T : Threads)
+      T.join();
+  }
+  for (const std::string &E : Errors) {
+    if (!E.empty()) {
+      Error = E;
+      return false;
+    }
+  }
+
+  Output = OutputImage();
+  if (!is_fat(Input->data(), Input->size())) {
+    Output.Size = Built[0].size();
+    add_slice(Output, 0, Built[0], Input);
+    return true;
+  }
+
+  // place every slice at its aligned offset behind the fat header. a file
+  // past 4 GiB needs the 64-bit header, which is larger, so the slices are
+  // placed again behind it
+  auto Place = [&](bool Use64) {
+    uint64_t off = make_fat_header(Slices, Use64).size();
+    for (size_t i = 0; i < Slices.size(); i++) {
+      uint64_t align = 1ULL << Slices[i].Align;
+      off = (off + align - 1) & ~(align - 1);
+      Slices[i].Offset = off;
+      Slices[i].Size = Built[i].size();
+      off += Built[i].size();
+    }
+    return off;
+  };
+  bool use64 = read<uint32_t>(Input->data()) == FAT_CIGAM_64;
+  uint64_t off = Place(use64);
+  if (!use64 && off > UINT32_MAX) {
+    use64 = true;
+    off = Place(use64);
+  }
+
+  Output.Size = off;
+  Output.Extents.push_back({0, make_fat_header(Slices, use64), {}, {}});
+  for (size_t i = 0; i < Slices.size(); i++)
+    add_slice(Output, Slices[i].Offset, Built[i], Input);
+  return true;
+}
+
+} // namespace machostrip
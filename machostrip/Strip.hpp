@@ -0,0 +1,104 @@
+//
+//  Strip.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef STRIP_HPP
+#define STRIP_HPP
+
+#include "IO.hpp"
+#include "NameIndex.hpp"
+#include "Scramble.hpp"
+#include "SymbolTable.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace LIEF {
+namespace MachO {
+class Binary;
+} // namespace MachO
+} // namespace LIEF
+
+namespace machostrip {
+
+// names that are never stripped. Names points into Text
+struct KeepList {
+  std::string Text;
+  NameIndex Names;
+  // hash of Text, part of the cache key
+  uint64_t Hash = 0;
+};
+
+// read a keep list with one name per line. empty lines and lines starting
+// with '#' are ignored
+bool read_keep_list(const std::string &Path, KeepList &Keep,
+                    std::string &Error);
+
+struct StripOptions {
+  // also remove external symbols
+  bool StripExt = false;
+  // how the string tables are scrambled
+  FillMode Fill = FillMode::Random;
+  // parse with ParserConfig::deep() instead of the strip profile, which
+  // skips the rebase and bind opcodes
+  bool DeepParse = false;
+  // always rebuild with LIEF instead of patching LINKEDIT in place
+  bool Rebuild = false;
+  // seed of every random choice. when unset it is derived from the input,
+  // so the same input is always stripped to the same output
+  std::optional<uint64_t> Seed;
+  // symbols kept whatever their kind
+  std::shared_ptr<const KeepList> Keep;
+  // replace the code signature the strip invalidates with an ad-hoc one
+  bool Sign = true;
+};
+
+// bumped whenever the output for the same input and options changes, so a
+// cached result of an older version is never reused
+inline constexpr char StripVersion[] = "6";
+
+// malformed section name can prevent Ghidra from loading the macho
+inline constexpr char ObfuscatedSectionName[] =
+    "\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11";
+
+// Hopper Demo Version checks if the binary contains this string, and if it
+// does, disassembly is not allowed
+inline constexpr char HopperExport[] =
+    "(c) 2014 - Cryptic Apps SARL - Disassembling not allowed.";
+
+// whether the strip renames the section Sectname of segment Segname
+bool is_renamed_section(std::string_view Segname, std::string_view Sectname);
+
+// whether the strip removes the symbol Name of kind K
+inline bool is_stripped_symbol(SymbolKind K, std::string_view Name,
+                               const StripOptions &Options) {
+  if (K != SymbolKind::Local &&
+      (!Options.StripExt || K != SymbolKind::External))
+    return false;
+  return !Options.Keep || !Options.Keep->Names.contains(Name);
+}
+
+// apply the strip passes to a single architecture. the symbols themselves
+// are removed by remove_symbols once the binary has been built. with
+// -strip-ext the external symbols Unexported returns true for are no longer
+// exported, or every stripped one when it is empty
+void strip_binary(
+    LIEF::MachO::Binary &Bin, const StripOptions &Options,
+    const std::function<bool(std::string_view)> &Unexported);
+
+// parse, strip, rebuild and scramble the mapped image in Input. the slices of a
+// fat image are processed concurrently. on failure false is returned and
+// Error describes what went wrong
+bool strip_image(const std::shared_ptr<const MappedFile> &Input,
+                 OutputImage &Output, const StripOptions &Options,
+                 std::string &Error);
+
+} // namespace machostrip
+
+#endif
@@ -0,0 +1,325 @@
+//
+//  SymbolTable.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "SymbolTable.hpp"
+#include "MachOFile.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+#include <numeric>
+#include <vector>
+
+namespace machostrip {
+
+// the kind of an nlist entry from its n_type alone
+static SymbolKind kind_of(uint8_t Type) {
+  if ((Type & N_STAB) || !(Type & N_EXT))
+    return SymbolKind::Local;
+  return (Type & N_TYPE) == N_UNDF ? SymbolKind::Undefined
+                                   : SymbolKind::External;
+}
+
+SymbolTable::SymbolTable(std::span<const uint8_t> Table,
+                         std::span<const uint8_t> Strings, bool Is64,
+                         const Range *Ranges)
+    : Strings((const char *)Strings.data(), Strings.size()) {
+  size_t entsize = Is64 ? sizeof(nlist_64) : sizeof(struct nlist);
+  uint32_t n = (uint32_t)(Table.size() / entsize);
+  Values.reserve(n);
+  Strx.reserve(n);
+  Types.reserve(n);
+  Sects.reserve(n);
+  Descs.reserve(n);
+
+  if (Ranges && Ranges->Begin <= Ranges->End && Ranges->End <= n) {
+    for (uint32_t i = 0; i < n; i++)
+      push(Table.data() + i * entsize, Is64);
+    ExternalBegin = Ranges->Begin;
+    UndefinedBegin = Ranges->End;
+    return;
+  }
+
+  // no usable LC_DYSYMTAB, order the symbols by kind, one pass per kind
+  FileIndex.reserve(n);
+  for (SymbolKind K :
+       {SymbolKind::Local, SymbolKind::External, SymbolKind::Undefined}) {
+    if (K == SymbolKind::External)
+      ExternalBegin = size();
+    if (K == SymbolKind::Undefined)
+      UndefinedBegin = size();
+    for (uint32_t i = 0; i < n; i++) {
+      // n_type is at the same offset in both layouts
+      const uint8_t *Entry = Table.data() + i * entsize;
+      if (kind_of(Entry[offsetof(nlist_64, n_type)]) != K)
+        continue;
+      push(Entry, Is64);
+      FileIndex.push_back(i);
+    }
+  }
+}
+
+void SymbolTable::push(const uint8_t *Entry, bool Is64) {
+  if (Is64) {
+    nlist_64 N = read<nlist_64>(Entry);
+    Values.push_back(N.n_value);
+    Strx.push_back(N.n_un.n_strx);
+    Types.push_back(N.n_type);
+    Sects.push_back(N.n_sect);
+    Descs.push_back(N.n_desc);
+  } else {
+    struct nlist N = read<struct nlist>(Entry);
+    Values.push_back(N.n_value);
+    Strx.push_back(N.n_un.n_strx);
+    Types.push_back(N.n_type);
+    Sects.push_back(N.n_sect);
+    Descs.push_back((uint16_t)N.n_desc);
+  }
+}
+
+std::string_view SymbolTable::name(uint32_t i) const {
+  uint32_t strx = Strx[i];
+  if (strx >= Strings.size())
+    return {};
+  const char *Name = Strings.data() + strx;
+  return {Name, strnlen(Name, Strings.size() - strx)};
+}
+
+SymbolKind SymbolTable::kind(uint32_t i) const {
+  return i < ExternalBegin    ? SymbolKind::Local
+         : i < UndefinedBegin ? SymbolKind::External
+                              : SymbolKind::Undefined;
+}
+
+SymbolTable::Range SymbolTable::range(SymbolKind K) const {
+  switch (K) {
+  case SymbolKind::Local:
+    return {0, ExternalBegin};
+  case SymbolKind::External:
+    return {ExternalBegin, UndefinedBegin};
+  case SymbolKind::Undefined:
+    return {UndefinedBegin, size()};
+  }
+  return {};
+}
+
+std::optional<uint32_t> SymbolTable::find(std::string_view Name) const {
+  if (!Index) {
+    // the defined externals go in first, so a local or a stab of the same
+    // name doesn't hide the definition
+    Index.emplace(size());
+    for (SymbolKind K :
+         {SymbolKind::External, SymbolKind::Local, SymbolKind::Undefined})
+      for (Range R = range(K); R.Begin < R.End; R.Begin++)
+        Index->insert(name(R.Begin), R.Begin);
+  }
+  if (const uint32_t *i = Index->find(Name))
+    return *i;
+  return std::nullopt;
+}
+
+void SymbolTable::erase(SymbolKind K) {
+  Range R = range(K);
+  if (R.Begin == R.End)
+    return;
+  // the indices past the range shift, so the index is rebuilt when needed
+  // and the file index of every symbol has to be kept from now on
+  Index.reset();
+  if (FileIndex.empty()) {
+    FileIndex.resize(size());
+    std::iota(FileIndex.begin(), FileIndex.end(), 0);
+  }
+  auto Erase = [&](auto &V) {
+    if (!V.empty())
+      V.erase(V.begin() + R.Begin, V.begin() + R.End);
+  };
+  Erase(Values);
+  Erase(Strx);
+  Erase(Types);
+  Erase(Sects);
+  Erase(Descs);
+  Erase(FileIndex);
+  uint32_t n = R.End - R.Begin;
+  if (K == SymbolKind::Local)
+    ExternalBegin -= n;
+  if (K != SymbolKind::Undefined)
+    UndefinedBegin -= n;
+}
+
+static constexpr uint32_t Removed = ~0U;
+static constexpr uint32_t RelocExtern = 1U << 27;
+static constexpr uint32_t RelocScattered = 0x80000000U;
+
+bool plan_symbol_removal(
+    const uint8_t *Data, size_t Size,
+    const std::function<bool(uint32_t, SymbolKind)> &Remove,
+    SymbolRemoval &Plan, std::string &Error) {
+  Plan = SymbolRemoval();
+  uint64_t end = commands_end(Data, Size);
+  if (!end) {
+    Error = "malformed load commands";
+    return false;
+  }
+  // relocations of object files point into the symbol table as well
+  if (read<mach_header>(Data).filetype == MH_OBJECT) {
+    Error = "object files are not supported";
+    return false;
+  }
+  bool is64 = read<uint32_t>(Data) == MH_MAGIC_64;
+
+  for (const Command &C : get_commands(Data, Size)) {
+    if (C.Cmd == LC_SYMTAB && C.Size >= sizeof(symtab_command))
+      Plan.SymtabOffset = C.Offset;
+    if (C.Cmd == LC_DYSYMTAB && C.Size >= sizeof(dysymtab_command))
+      Plan.DysymtabOffset = C.Offset;
+  }
+  if (!Plan.SymtabOffset)
+    return true;
+  if (!Plan.DysymtabOffset) {
+    Error = "no LC_DYSYMTAB";
+    return false;
+  }
+  symtab_command SC = read<symtab_command>(Data + Plan.SymtabOffset);
+  dysymtab_command DC = read<dysymtab_command>(Data + Plan.DysymtabOffset);
+  if (DC.ntoc || DC.nmodtab || DC.nextrefsyms) {
+    Error = "prebound tables are not supported";
+    return false;
+  }
+  if (DC.ilocalsym != 0 || DC.iextdefsym != DC.nlocalsym ||
+      DC.iundefsym != DC.iextdefsym + DC.nextdefsym ||
+      (uint64_t)DC.iundefsym + DC.nundefsym != SC.nsyms) {
+    Error = "symbol table is not partitioned by LC_DYSYMTAB";
+    return false;
+  }
+  size_t entsize = is64 ? sizeof(nlist_64) : sizeof(struct nlist);
+  if ((uint64_t)SC.symoff + (uint64_t)SC.nsyms * entsize > Size ||
+      (uint64_t)DC.indirectsymoff + (uint64_t)DC.nindirectsyms * 4 > Size ||
+      (uint64_t)DC.extreloff + (uint64_t)DC.nextrel * 8 > Size) {
+    Error = "symbol table is truncated";
+    return false;
+  }
+  const uint8_t *Indirect = Data + DC.indirectsymoff;
+  const uint8_t *Relocs = Data + DC.extreloff;
+
+  // mark what the indirect symbol table pins
+  std::vector<uint32_t> &Remap = Plan.Remap;
+  Remap.assign(SC.nsyms, 0);
+  for (uint32_t i = 0; i < DC.nindirectsyms; i++) {
+    uint32_t index = read<uint32_t>(Indirect + i * 4);
+    if (!(index & (INDIRECT_SYMBOL_LOCAL | INDIRECT_SYMBOL_ABS)) &&
+        index >= DC.iextdefsym && index < DC.iundefsym)
+      Remap[index] = 1;
+  }
+
+  // decide, then hand out the new indices. the ranges keep their order, so
+  // a kept symbol's new index is the number of kept symbols before it
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < SC.nsyms; i++) {
+    SymbolKind K = i < DC.iextdefsym   ? SymbolKind::Local
+                   : i < DC.iundefsym ? SymbolKind::External
+                                      : SymbolKind::Undefined;
+    if (!Remap[i] && Remove(i, K)) {
+      Remap[i] = Removed;
+      continue;
+    }
+    Remap[i] = kept++;
+    Plan.Locals += K == SymbolKind::Local;
+    Plan.Externals += K == SymbolKind::External;
+  }
+  if (kept == SC.nsyms) {
+    Remap.clear();
+    return true;
+  }
+  Plan.Kept = kept;
+
+  // an external relocation against a removed symbol can't be rewritten
+  for (uint32_t i = 0; i < DC.nextrel; i++) {
+    uint32_t address = read<uint32_t>(Relocs + i * 8);
+    uint32_t info = read<uint32_t>(Relocs + i * 8 + 4);
+    if ((address & RelocScattered) || !(info & RelocExtern))
+      continue;
+    uint32_t index = info & 0xffffff;
+    if (index >= SC.nsyms || Remap[index] == Removed) {
+      Error = "relocation against a removed symbol";
+      Remap.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+// carry out Plan on the image whose load commands are at Head. At returns
+// the writable bytes of a range of the image
+template <typename F>
+static void apply_removal(uint8_t *Head, const SymbolRemoval &Plan, F At) {
+  const std::vector<uint32_t> &Remap = Plan.Remap;
+  if (Remap.empty())
+    return;
+  uint8_t *Symtab = Head + Plan.SymtabOffset;
+  uint8_t *Dysymtab = Head + Plan.DysymtabOffset;
+  symtab_command SC = read<symtab_command>(Symtab);
+  dysymtab_command DC = read<dysymtab_command>(Dysymtab);
+  size_t entsize = read<uint32_t>(Head) == MH_MAGIC_64 ? sizeof(nlist_64)
+                                                        : sizeof(struct nlist);
+  uint8_t *Table = At(SC.symoff, (uint64_t)SC.nsyms * entsize);
+  uint8_t *Indirect = At(DC.indirectsymoff, DC.nindirectsyms * 4ULL);
+  uint8_t *Relocs = At(DC.extreloff, DC.nextrel * 8ULL);
+  uint32_t kept = Plan.Kept;
+
+  // compact in place, a symbol never moves up
+  for (uint32_t i = 0; i < SC.nsyms; i++)
+    if (Remap[i] != Removed && Remap[i] != i)
+      std::memmove(Table + Remap[i] * entsize, Table + i * entsize, entsize);
+  std::fill(Table + kept * entsize, Table + SC.nsyms * entsize, 0);
+
+  for (uint32_t i = 0; i < DC.nindirectsyms; i++) {
+    uint32_t index = read<uint32_t>(Indirect + i * 4);
+    if ((index & (INDIRECT_SYMBOL_LOCAL | INDIRECT_SYMBOL_ABS)) ||
+        index >= SC.nsyms)
+      continue;
+    write<uint32_t>(Indirect + i * 4, Remap[index] == Removed
+                                          ? INDIRECT_SYMBOL_LOCAL
+                                          : Remap[index]);
+  }
+  for (uint32_t i = 0; i < DC.nextrel; i++) {
+    uint32_t address = read<uint32_t>(Relocs + i * 8);
+    uint32_t info = read<uint32_t>(Relocs + i * 8 + 4);
+    if ((address & RelocScattered) || !(info & RelocExtern))
+      continue;
+    write<uint32_t>(Relocs + i * 8 + 4,
+                    (info & 0xff000000U) | Remap[info & 0xffffff]);
+  }
+
+  SC.nsyms = kept;
+  write(Symtab, SC);
+  DC.nlocalsym = Plan.Locals;
+  DC.iextdefsym = Plan.Locals;
+  DC.nextdefsym = Plan.Externals;
+  DC.iundefsym = Plan.Locals + Plan.Externals;
+  DC.nundefsym = kept - Plan.Locals - Plan.Externals;
+  write(Dysymtab, DC);
+}
+
+void apply_symbol_removal(SliceImage &Image, const SymbolRemoval &Plan) {
+  apply_removal(Image.Head.data(), Plan, [&](uint64_t Offset, uint64_t Size) {
+    return Image.data(Offset, Size);
+  });
+}
+
+bool remove_symbols(uint8_t *Data, size_t Size,
+                    const std::function<bool(uint32_t, SymbolKind)> &Remove,
+                    std::string &Error) {
+  SymbolRemoval Plan;
+  if (!plan_symbol_removal(Data, Size, Remove, Plan, Error))
+    return false;
+  apply_removal(Data, Plan, [&](uint64_t Offset, uint64_t) {
+    return Data + Offset;
+  });
+  return true;
+}
+
+} // namespace machostrip
@@ -0,0 +1,125 @@
+//
+//  SymbolTable.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef SYMBOLTABLE_HPP
+#define SYMBOLTABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "NameIndex.hpp"
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace machostrip {
+
+// the LC_DYSYMTAB range a symbol lives in
+enum class SymbolKind { Local, External, Undefined };
+
+// the nlist entries of a symbol table kept as one array per field. names
+// are never copied, they are read out of the string table on request. the
+// symbols are ordered local, external, undefined like the LC_DYSYMTAB
+// ranges, so every kind is a contiguous range of indices
+class SymbolTable {
+public:
+  // a half-open range of indices
+  struct Range {
+    uint32_t Begin = 0;
+    uint32_t End = 0;
+  };
+
+  SymbolTable() = default;
+
+  // decode the nlist entries in Table. Ranges holds the first index of the
+  // external and of the undefined symbols as given by LC_DYSYMTAB. without
+  // it, or if it doesn't fit, the symbols are partitioned by their n_type
+  SymbolTable(std::span<const uint8_t> Table, std::span<const uint8_t> Strings,
+              bool Is64, const Range *Ranges = nullptr);
+
+  uint32_t size() const { return (uint32_t)Strx.size(); }
+  bool empty() const { return Strx.empty(); }
+
+  std::string_view name(uint32_t i) const;
+  uint64_t value(uint32_t i) const { return Values[i]; }
+  uint32_t strx(uint32_t i) const { return Strx[i]; }
+  uint8_t type(uint32_t i) const { return Types[i]; }
+  uint8_t sect(uint32_t i) const { return Sects[i]; }
+  uint16_t desc(uint32_t i) const { return Descs[i]; }
+  SymbolKind kind(uint32_t i) const;
+  // index of the entry in the symbol table it was read from
+  uint32_t file_index(uint32_t i) const {
+    return FileIndex.empty() ? i : FileIndex[i];
+  }
+
+  Range range(SymbolKind K) const;
+
+  // index of a symbol named Name, the defined external one if there is
+  // one. the hash index is built on the first lookup and kept until the
+  // table changes
+  std::optional<uint32_t> find(std::string_view Name) const;
+
+  // drop every symbol of kind K, one erase per field array
+  void erase(SymbolKind K);
+
+private:
+  void push(const uint8_t *Entry, bool Is64);
+
+  std::string_view Strings;
+  std::vector<uint64_t> Values;
+  std::vector<uint32_t> Strx;
+  std::vector<uint8_t> Types;
+  std::vector<uint8_t> Sects;
+  std::vector<uint16_t> Descs;
+  // only filled when the symbols had to be reordered
+  std::vector<uint32_t> FileIndex;
+  uint32_t ExternalBegin = 0;
+  uint32_t UndefinedBegin = 0;
+  mutable std::optional<NameIndex> Index;
+};
+
+// remove every symbol of the thin mach-o at Data for which Remove returns
+// true, in place and in a single pass. the kept symbols are compacted in
+// order, the LC_DYSYMTAB ranges shrink accordingly and the indirect symbol
+// table and the external relocations are remapped through one index table.
+// string table offsets are left alone. an external symbol the indirect
+// symbol table points to is never offered to Remove, a removed local one
+// becomes INDIRECT_SYMBOL_LOCAL. nothing is modified when false is returned
+bool remove_symbols(uint8_t *Data, size_t Size,
+                    const std::function<bool(uint32_t, SymbolKind)> &Remove,
+                    std::string &Error);
+
+struct SliceImage;
+
+// what remove_symbols does to an image, decided without modifying it
+struct SymbolRemoval {
+  uint64_t SymtabOffset = 0;
+  uint64_t DysymtabOffset = 0;
+  // new index of every symbol, ~0U for a removed one. empty when nothing is
+  // removed
+  std::vector<uint32_t> Remap;
+  uint32_t Kept = 0;
+  uint32_t Locals = 0;
+  uint32_t Externals = 0;
+};
+
+// the first half of remove_symbols: decide what is removed, and fail for
+// the same reasons remove_symbols does
+bool plan_symbol_removal(
+    const uint8_t *Data, size_t Size,
+    const std::function<bool(uint32_t, SymbolKind)> &Remove,
+    SymbolRemoval &Plan, std::string &Error);
+
+// the second half of remove_symbols: carry out Plan on Image, which has to
+// hold the same load commands and symbol tables as the planned image, with
+// the tables outside of Borrowed
+void apply_symbol_removal(SliceImage &Image, const SymbolRemoval &Plan);
+
+} // namespace machostrip
+
+#endif
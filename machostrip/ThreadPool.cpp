@@ -0,0 +1,104 @@
+//
+//  ThreadPool.cpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace machostrip {
+
+// index of the pool worker running on this thread, -1 elsewhere
+static thread_local int WorkerIndex = -1;
+static thread_local const ThreadPool *WorkerPool = nullptr;
+
+ThreadPool::ThreadPool(unsigned Threads) {
+  if (!Threads)
+    Threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < Threads; i++)
+    Queues.push_back(std::make_unique<Queue>());
+  for (unsigned i = 0; i < Threads; i++)
+    Workers.emplace_back([this, i] { run(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> L(Lock);
+    Stop = true;
+  }
+  Wake.notify_all();
+  for (std::thread &W : Workers)
+    W.join();
+}
+
+void ThreadPool::submit(Task T) {
+  unsigned index = WorkerPool == this
+                       ? (unsigned)WorkerIndex
+                       : Next.fetch_add(1, std::memory_order_relaxed) %
+                             size();
+  {
+    std::lock_guard<std::mutex> L(Queues[index]->Lock);
+    Queues[index]->Tasks.push_back(std::move(T));
+  }
+  {
+    std::lock_guard<std::mutex> L(Lock);
+    Queued++;
+    Pending++;
+  }
+  Wake.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> L(Lock);
+  Idle.wait(L, [&] { return Pending == 0; });
+}
+
+bool ThreadPool::pop(unsigned Index, Task &T) {
+  {
+    Queue &Own = *Queues[Index];
+    std::lock_guard<std::mutex> L(Own.Lock);
+    if (!Own.Tasks.empty()) {
+      T = std::move(Own.Tasks.back());
+      Own.Tasks.pop_back();
+      return true;
+    }
+  }
+  for (unsigned i = 1; i < size(); i++) {
+    Queue &Victim = *Queues[(Index + i) % size()];
+    std::lock_guard<std::mutex> L(Victim.Lock);
+    if (!Victim.Tasks.empty()) {
+      T = std::move(Victim.Tasks.front());
+      Victim.Tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run(unsigned Index) {
+  WorkerIndex = (int)Index;
+  WorkerPool = this;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> L(Lock);
+      Wake.wait(L, [&] { return Queued || Stop; });
+      if (!Queued && Stop)
+        return;
+      Queued--;
+    }
+    // a task is reserved for us, but another worker may already have taken
+    // the copy in our deque, so keep looking until one is found
+    Task T;
+    while (!pop(Index, T))
+      std::this_thread::yield();
+    T();
+    {
+      std::lock_guard<std::mutex> L(Lock);
+      if (--Pending == 0)
+        Idle.notify_all();
+    }
+  }
+}
+
+} // namespace machostrip
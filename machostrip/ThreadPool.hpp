@@ -0,0 +1,108 @@
+//
+//  ThreadPool.hpp
+//
+//  Created by 123456qwerty on 2026/10/17.
+//
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace machostrip {
+
+// fixed size pool where every worker owns a deque of tasks. a worker runs its
+// own tasks newest first and steals the oldest task of another worker when
+// it runs dry, so a few slow inputs don't leave the other threads idle
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  // Threads == 0 picks one worker per hardware thread
+  explicit ThreadPool(unsigned Threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // queue T, from a worker it goes to that worker's own deque
+  void submit(Task T);
+
+  // block until every submitted task has finished
+  void wait();
+
+  unsigned size() const { return (unsigned)Workers.size(); }
+
+private:
+  struct Queue {
+    std::mutex Lock;
+    std::deque<Task> Tasks;
+  };
+
+  void run(unsigned Index);
+  bool pop(unsigned Index, Task &T);
+
+  std::vector<std::unique_ptr<Queue>> Queues;
+  std::vector<std::thread> Workers;
+  std::atomic<unsigned> Next{0};
+
+  std::mutex Lock;
+  std::condition_variable Wake;
+  std::condition_variable Idle;
+  size_t Queued = 0;
+  size_t Pending = 0;
+  bool Stop = false;
+};
+
+// blocking FIFO with a fixed capacity, used to hand work between pipeline
+// stages without letting a fast stage run arbitrarily far ahead
+template <typename T> class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t Capacity) : Capacity(Capacity ? Capacity : 1) {}
+
+  void push(T Value) {
+    std::unique_lock<std::mutex> L(Lock);
+    NotFull.wait(L, [&] { return Items.size() < Capacity; });
+    Items.push_back(std::move(Value));
+    NotEmpty.notify_one();
+  }
+
+  // returns nothing once the queue is closed and drained
+  std::optional<T> pop() {
+    std::unique_lock<std::mutex> L(Lock);
+    NotEmpty.wait(L, [&] { return !Items.empty() || Closed; });
+    if (Items.empty())
+      return std::nullopt;
+    T Value = std::move(Items.front());
+    Items.pop_front();
+    NotFull.notify_one();
+    return Value;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> L(Lock);
+    Closed = true;
+    NotEmpty.notify_all();
+  }
+
+private:
+  std::mutex Lock;
+  std::condition_variable NotEmpty;
+  std::condition_variable NotFull;
+  std::deque<T> Items;
+  size_t Capacity;
+  bool Closed = false;
+};
+
+} // namespace machostrip
+
+#endif
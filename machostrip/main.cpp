@@ -4,97 +4,179 @@
 //  Created by 123456qwerty on 2023/8/11.
 //
 
-#include "LIEF/LIEF.hpp"
-#include <fstream>
+#include "Batch.hpp"
+#include "Cache.hpp"
+#include "IO.hpp"
+#include "MachOView.hpp"
+#include "Strip.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <mach-o/loader.h>
-#include <random>
 #include <string>
 
-using namespace LIEF::MachO;
+using namespace machostrip;
 
-int main(int argc, const char *argv[]) {
-  if (argc < 3) {
-    std::cout << "Usage: machostrip [-strip-ext](optional) [mach-o file] "
-                 "[output file]"
-              << std::endl;
+// print the architecture, uuid, function start and fixup counts of every
+// slice
+static int print_info(const std::string &Path) {
+  MappedFile File;
+  if (!File.open(Path)) {
+    std::cerr << "machostrip: failed to read " << Path << std::endl;
+    return 1;
+  }
+  std::vector<Slice> Slices = get_slices(File.data(), File.size());
+  if (Slices.empty()) {
+    std::cerr << "machostrip: " << Path << ": not a mach-o file" << std::endl;
     return 1;
   }
+  for (const Slice &S : Slices) {
+    MachOView View(File.data() + S.Offset, S.Size);
+    if (!View.valid())
+      continue;
+    char Line[64];
+    snprintf(Line, sizeof(Line), "cputype 0x%x subtype 0x%x filetype 0x%x",
+             (unsigned)View.cpu_type(), (unsigned)View.cpu_subtype(),
+             View.file_type());
+    std::cout << Line;
+    if (std::optional<std::array<uint8_t, 16>> UUID = View.uuid()) {
+      std::cout << " uuid ";
+      for (size_t i = 0; i < UUID->size(); i++) {
+        snprintf(Line, sizeof(Line), "%s%02X",
+                 i == 4 || i == 6 || i == 8 || i == 10 ? "-" : "",
+                 (*UUID)[i]);
+        std::cout << Line;
+      }
+    }
+    std::cout << " function starts " << View.function_starts().size()
+              << " rebases " << View.rebases().size() << " bindings "
+              << View.bindings().size() << std::endl;
+  }
+  return 0;
+}
+
+static void usage() {
+  std::cout << "Usage: machostrip [-strip-ext](optional) "
+               "[-fill-pattern](optional) [-deep](optional) "
+               "[-rebuild](optional) [-no-sign](optional) "
+               "[-seed n](optional) "
+               "[-keep names](optional) [mach-o file] [output file]\n"
+               "         use - to read from stdin or write to stdout\n"
+               "         -cache-dir [dir] reuses outputs of identical inputs, "
+               "-cache-size [MiB] bounds it (default 1024),\n"
+               "         -cache-link hard links hits where they can't be "
+               "cloned, never modify such outputs in place\n"
+               "       machostrip -info [mach-o file]\n"
+               "       machostrip [options] [-j threads] -batch [manifest]\n"
+               "         manifest: one \"input<TAB>output\" pair per line"
+            << std::endl;
+}
 
-  bool stripext = false;
-  int fileargvindex = 1;
-  int outputargvindex = 2;
+int main(int argc, const char *argv[]) {
+  StripOptions Options;
+  const char *manifest = nullptr;
+  const char *cache_dir = nullptr;
+  const char *keep_path = nullptr;
+  uint64_t cache_size = 1024;
+  bool cache_link = false;
+  unsigned threads = 0;
 
-  if (!strcmp(argv[1], "-strip-ext")) {
-    stripext = true;
-    fileargvindex++;
-    outputargvindex++;
+  int argi = 1;
+  for (; argi < argc && argv[argi][0] == '-'; argi++) {
+    if (!strcmp(argv[argi], "-strip-ext"))
+      Options.StripExt = true;
+    else if (!strcmp(argv[argi], "-fill-pattern"))
+      Options.Fill = FillMode::Pattern;
+    else if (!strcmp(argv[argi], "-deep"))
+      Options.DeepParse = true;
+    else if (!strcmp(argv[argi], "-rebuild"))
+      Options.Rebuild = true;
+    else if (!strcmp(argv[argi], "-no-sign"))
+      Options.Sign = false;
+    else if (!strcmp(argv[argi], "-seed") && argi + 1 < argc)
+      Options.Seed = strtoull(argv[++argi], nullptr, 0);
+    else if (!strcmp(argv[argi], "-keep") && argi + 1 < argc)
+      keep_path = argv[++argi];
+    else if (!strcmp(argv[argi], "-batch") && argi + 1 < argc)
+      manifest = argv[++argi];
+    else if (!strcmp(argv[argi], "-info") && argi + 2 == argc)
+      return print_info(argv[argi + 1]);
+    else if (!strcmp(argv[argi], "-cache-dir") && argi + 1 < argc)
+      cache_dir = argv[++argi];
+    else if (!strcmp(argv[argi], "-cache-size") && argi + 1 < argc)
+      cache_size = strtoull(argv[++argi], nullptr, 10);
+    else if (!strcmp(argv[argi], "-cache-link"))
+      cache_link = true;
+    else if (!strcmp(argv[argi], "-j") && argi + 1 < argc)
+      threads = (unsigned)strtoul(argv[++argi], nullptr, 10);
+    else
+      break;
   }
 
-  std::unique_ptr<FatBinary> Binaries = Parser::parse(argv[fileargvindex]);
-  for (Binary &Bin : *Binaries) {
-    // remove function starts
-    Bin.function_starts()->functions({});
-    // remove local and external symbols
-    std::vector<Symbol *> symtoremove;
-    for (Symbol &Sym : Bin.symbols()) {
-      if (Sym.category() == Symbol::CATEGORY::LOCAL ||
-          (stripext && Sym.category() == Symbol::CATEGORY::EXTERNAL))
-        symtoremove.emplace_back(&Sym);
-    }
-    for (Symbol *Sym : symtoremove)
-      Bin.remove(*Sym);
-    for (SegmentCommand &Seg : Bin.segments()) {
-      if (Seg.name() == "__TEXT" || Seg.name() == "__DATA" ||
-          Seg.name() == "__DATA__CONST")
-        for (Section &Sec : Seg.sections()) {
-          if (Sec.name().find("__objc") == std::string::npos &&
-              Sec.name().find("__swift") == std::string::npos &&
-              Sec.name().find("__unwind") == std::string::npos &&
-              Sec.name().find("__eh") == std::string::npos &&
-              Sec.name().find("__gcc") == std::string::npos &&
-              Sec.name().find("__auth") == std::string::npos &&
-              Sec.name().find("__got") == std::string::npos) {
-            // malformed section name can prevent Ghidra from loading the macho
-            Sec.name("\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11"
-                     "\x11\x11");
-          }
-        }
+  if (keep_path) {
+    auto Keep = std::make_shared<KeepList>();
+    std::string Error;
+    if (!read_keep_list(keep_path, *Keep, Error)) {
+      std::cerr << "machostrip: " << Error << std::endl;
+      return 1;
     }
-    // Hopper Demo Version checks if the binary contains this string, and if it
-    // does, disassembly is not allowed
-    Bin.add_exported_function(
-        0, "(c) 2014 - Cryptic Apps SARL - Disassembling not allowed.");
+    Options.Keep = std::move(Keep);
   }
-  const std::string output_name = argv[outputargvindex];
-  Binaries->write(output_name);
 
-  // obfuscate symbol stub name
-  std::set<uint32_t> stroffs;
-  std::map<uint32_t, uint32_t> strtabsize;
+  std::unique_ptr<ResultCache> Cache;
+  if (cache_dir) {
+    Cache = std::make_unique<ResultCache>(cache_dir, cache_size << 20,
+                                          cache_link);
+    std::string Error;
+    if (!Cache->open(Error)) {
+      std::cerr << "machostrip: " << Error << std::endl;
+      return 1;
+    }
+  }
 
-  std::unique_ptr<FatBinary> Binaries2 = Parser::parse(output_name);
-  for (Binary &Bin : *Binaries2) {
-    uint32_t stroff =
-        (uint32_t)Bin.fat_offset() + Bin.symbol_command()->strings_offset();
-    stroffs.insert(stroff);
-    strtabsize[stroff] = Bin.symbol_command()->strings_size();
+  if (manifest) {
+    if (argi != argc) {
+      usage();
+      return 1;
+    }
+    std::vector<BatchJob> Jobs;
+    std::string Error;
+    if (!read_manifest(manifest, Jobs, Error)) {
+      std::cerr << "machostrip: " << Error << std::endl;
+      return 1;
+    }
+    return run_batch(Jobs, Options, threads, Cache.get()) ? 1 : 0;
   }
 
-  std::mt19937 eng(rand());
-  std::uniform_int_distribution<uint8_t> dis(1, 0xff);
+  if (argc - argi != 2) {
+    usage();
+    return 1;
+  }
+  const std::string input_name = argv[argi];
+  const std::string output_name = argv[argi + 1];
 
-  std::fstream file;
-  file.open(output_name, std::ios::in | std::ios::out);
-  for (uint32_t off : stroffs) {
-    uint32_t temp = off + strtabsize[off];
-    while (off != temp) {
-      file.seekp(off, std::ios::beg);
-      file << dis(eng);
-      off += 1;
-    }
+  auto Input = std::make_shared<MappedFile>();
+  OutputImage Output;
+  std::string Error;
+  if (!Input->open(input_name)) {
+    std::cerr << "machostrip: failed to read " << input_name << std::endl;
+    return 1;
+  }
+  std::string Key;
+  if (Cache) {
+    Key = ResultCache::key(Input->data(), Input->size(), Options);
+    if (Cache->fetch(Key, output_name))
+      return 0;
+  }
+  if (!strip_image(Input, Output, Options, Error)) {
+    std::cerr << "machostrip: " << input_name << ": " << Error << std::endl;
+    return 1;
+  }
+  if (Cache ? !Cache->write(Key, output_name, Output)
+            : !write_image(output_name, Output)) {
+    std::cerr << "machostrip: failed to write " << output_name << std::endl;
+    return 1;
   }
-  file.close();
 
   return 0;
 }
@@ -0,0 +1,29 @@
+#!/bin/sh
+#
+#  in_place.sh
+#
+#  Created by 123456qwerty on 2026/10/17.
+#
+#  stripping a file over itself has to give the same bytes as writing a new
+#  file, both for a single file and for a batch line. a fat input covers
+#  every slice. usage: in_place.sh path/to/machostrip [mach-o file]
+#
+
+set -eu
+
+tool=${1:?usage: in_place.sh path/to/machostrip [mach-o file]}
+input=${2:-$tool}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cp "$input" "$dir/in"
+cp "$input" "$dir/same"
+cp "$input" "$dir/batch"
+"$tool" -seed 1 "$dir/in" "$dir/out"
+"$tool" -seed 1 "$dir/same" "$dir/same"
+printf '%s\t%s\n' "$dir/batch" "$dir/batch" > "$dir/manifest"
+"$tool" -seed 1 -batch "$dir/manifest"
+
+cmp "$dir/out" "$dir/same"
+cmp "$dir/out" "$dir/batch"
+echo "in place: ok"